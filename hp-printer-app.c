@@ -14,6 +14,19 @@
 # include <pappl/pappl.h>
 # include "icons.h"
 # include <math.h>
+# include <pthread.h>
+# include <stdatomic.h>
+# include <stdint.h>
+# include <strings.h>
+# include <time.h>
+#  if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#    include <immintrin.h>
+#    define PCL_X86	1		// Choose SSE2/AVX2 kernels at run time
+#    define PCL_AVX2	__attribute__((target("avx2")))
+#    define PCL_SSE2	__attribute__((target("sse2")))
+#  elif defined(__ARM_NEON)
+#    include <arm_neon.h>
+#  endif // (__x86_64__ || __i386__) && __GNUC__
 
 
 //
@@ -40,6 +53,18 @@
 // Constants...
 //
 
+#define PCL_BAND_HEIGHT	32		// Number of lines in a band
+#define PCL_BLOCK_SIZE	32767		// Maximum size of adaptive compression block
+#define PCL_CACHE_SIZE	16		// Number of cached lines per worker (power of 2)
+#define PCL_MAX_EFFORT	2		// Maximum compression effort
+#define PCL_MAX_SNAP	64		// Maximum solid snapping tolerance
+#define PCL_MAX_WORKERS	64		// Maximum number of band worker threads
+#define PCL_OUTPUT_SIZE	65536		// Size of job output buffer
+#define PCL_TILE_SIZE	512		// Pixels per tile for fused 8-bit lines (multiple of 64)
+
+#define PCL6_BLOCK_HEIGHT 32		// Default lines per PCL XL ReadImage block
+#define PCL6_MAX_BLOCK_HEIGHT 256	// Maximum lines per PCL XL ReadImage block
+
 typedef enum hp_driver_e		// Drivers
 {
   HP_DRIVER_DESKJET,			// PCL 3 Deskjet
@@ -285,22 +310,158 @@ enum pcl6_simplex_page_mode
 // Types...
 //
 
-typedef struct pcl_s			// Job data
+typedef struct pcl_s pcl_t;		// Job data
+
+typedef struct pcl_band_s		// Band of lines in the raster ring
+{
+  unsigned	num_lines,		// Number of lines
+		y[PCL_BAND_HEIGHT],	// Line numbers
+		feed[PCL_BAND_HEIGHT],	// Number of blank lines before each line
+		prev_y;			// Line number of previous line
+  bool		has_prev,		// Is there a previous line for the seed rows?
+		end;			// End of page?
+  atomic_bool	done;			// Has a worker encoded this band?
+  unsigned char	*pixels,		// Source lines, previous line first
+		*out_buffer;		// Encoded PCL data
+  size_t	out_bytes;		// Bytes of encoded PCL data
+} pcl_band_t;
+
+typedef struct pcl_ring_s		// Ring of bands
+{
+  unsigned	num_bands;		// Number of bands (power of 2)
+  pcl_band_t	*bands;			// Bands
+  unsigned char	*buffer;		// Line and output data for all bands
+  atomic_uint	head,			// Next band to fill (job thread)
+		next,			// Next band to encode (workers)
+		tail,			// Next band to send (output thread)
+		waiting;		// Number of threads waiting
+  atomic_bool	stop;			// Stop the workers?
+  pthread_mutex_t mutex;		// Mutex for waiting
+  pthread_cond_t cond;			// Condition for waiting
+  pthread_t	thread;			// Output thread
+  bool		running;		// Are the threads running?
+  pappl_device_t *device;		// Output device
+} pcl_ring_t;
+
+typedef struct pcl_cache_s		// Cached line
+{
+  bool		valid;			// Is this entry in use?
+  uint64_t	hash;			// Hash of source line and dither phase
+  unsigned	phase;			// Dither phase (line number & 15)
+  unsigned char	*pixels,		// Printable area of source line
+		*planes[4],		// Dithered planes
+		*packed[4];		// PackBits-compressed planes
+  unsigned	lengths[4],		// Length of planes without trailing zeros
+		packed_lengths[4];	// Length of PackBits-compressed planes
+} pcl_cache_t;
+
+typedef struct pcl_effort_s		// Measurements for a compression effort
+{
+  bool		valid;			// Has this effort been measured?
+  double	nsecs_per_line,		// Encoding time per line
+		bytes_per_line;		// Encoded bytes per line
+} pcl_effort_t;
+
+typedef struct pcl_kernels_s		// Vector kernels for an instruction set
+{
+  const char	*name;			// Name of instruction set
+  size_t	(*blank)(const unsigned char *line, size_t length, unsigned char white);
+					// Count leading white bytes
+  size_t	(*compare)(const unsigned char *line, const unsigned char *seed, size_t length);
+					// Count leading bytes matching the seed row
+  size_t	(*copy_1bit)(unsigned char *dst, const unsigned char *src, size_t length, unsigned shift);
+					// Shift and copy 1-bit pixels
+  unsigned	(*dither_8bit)(unsigned char *dst, const unsigned char *src, const unsigned char *dither, unsigned count, bool black);
+					// Dither 8-bit black or gray pixels
+  unsigned	(*dither_rgb)(unsigned char *planes[4], const unsigned char *src, const unsigned char *dither, unsigned count, unsigned *used);
+					// Separate and dither 8-bit sRGB pixels
+  size_t	(*packbits)(const unsigned char *line, size_t count, bool repeat);
+					// Count leading PackBits run positions
+  size_t	(*snap)(unsigned char *dst, const unsigned char *src, size_t length, unsigned char tolerance);
+					// Snap nearly solid bytes to 0 or 255
+} pcl_kernels_t;
+
+typedef struct pcl_worker_s		// Band worker data
+{
+  pcl_t		*pcl;			// Job data
+  pthread_t	thread;			// Worker thread
+  pcl_cache_t	cache[PCL_CACHE_SIZE];	// Dithered line cache
+  unsigned	cache_hits,		// Number of lines found in the cache
+		cache_misses,		// Number of lines dithered
+		black_lines,		// Number of color lines sent as black only
+		encode_lines;		// Number of lines encoded
+  uint64_t	encode_nsecs;		// Time spent encoding bands
+  unsigned char	*seed[4],		// Seed rows for delta row compression
+		*comp_buffer,		// Compression buffer
+		*delta_buffer,		// Delta row compression buffer
+		*block;			// Adaptive compression block, if any
+  unsigned	seed_length[4];		// Length of seed rows without trailing zeros
+  int		compression;		// Current compression mode
+  size_t	block_bytes;		// Bytes in adaptive compression block
+  int		block_last;		// Last row command in block
+} pcl_worker_t;
+
+struct pcl_s				// Job data
 {
   hp_driver_t	driver;			// Driver to use
-  size_t	linesize;		// Size of output line
+  size_t	linesize,		// Size of output line
+		bytes_per_line;		// Size of source line
   unsigned	width,			// Width
 		height,			// Height
 		xstart,			// First column on page/line
 		xend,			// Last column on page/line
 		ystart,			// First line on page
 		yend;			// Last line on page
-  unsigned char	*planes[4],		// Output buffers
-		*comp_buffer;		// Compression buffer
+  pappl_dither_t screen;		// Dither array for the job
+  unsigned char	*dither[16],		// Dither rows tiled to the line width
+		*dither_buffer,		// Tiled dither rows for the job
+		*snap_line;		// Snapped copy of the current line, if any
+  unsigned	dither_width;		// Width of tiled dither rows
+  unsigned char	flat[16][512];		// 16-pixel black patterns for each level
+  unsigned	flat_shift;		// Rotation of patterns for the left margin
+  unsigned	snap_tolerance;		// Solid snapping tolerance, 0 for none
   unsigned	num_planes,		// Number of color planes
+		bits_per_pixel,		// Source bits per pixel
 		feed;			// Number of lines to skip
-  int		compression;		// Compression mode
-} pcl_t;
+  cups_cspace_t	color_space;		// Source color space
+  bool		(*write_line)(pcl_t *pcl, pappl_device_t *device, unsigned y, const unsigned char *pixels);
+					// Line writer for the page
+  unsigned	(*dither_line)(pcl_t *pcl, unsigned char *planes[4], unsigned y, const unsigned char *pixels);
+					// Line ditherer for the page, if any
+  void		(*encode_band)(pcl_t *pcl, pcl_worker_t *worker, pcl_band_t *band);
+					// Band encoder for the page
+  unsigned	comp_modes,		// Supported compression modes (bitmask)
+		page_modes,		// Compression modes used for the page (bitmask)
+		effort;			// Compression effort for the page
+  pcl_effort_t	efforts[PCL_MAX_EFFORT + 1];
+					// Measurements for each compression effort
+  double	io_nsecs_per_byte;	// Time blocked writing per byte
+  uint64_t	io_nsecs,		// Time blocked writing to the device for the page
+		io_bytes,		// Bytes written to the device for the page
+		page_nsecs;		// Time the page was started
+  unsigned	num_workers;		// Number of band workers
+  pcl_worker_t	*workers;		// Band workers
+  pcl_band_t	*band;			// Band being filled, if any
+  const unsigned char *prev_pixels;	// Previous non-blank line, if any
+  unsigned	prev_y;			// Line number of previous non-blank line
+  atomic_bool	out_error;		// Did a device write fail?
+  size_t	out_bytes;		// Bytes in output buffer
+  unsigned char	out_buffer[PCL_OUTPUT_SIZE];
+					// Output buffer
+  pcl_ring_t	ring;			// Ring of bands
+#if WITH_PCL6
+  unsigned	image_height,		// Maximum lines per ReadImage block
+		image_y,		// First line in block
+		image_lines;		// Number of lines in block
+  unsigned char	*image_raw,		// Uncompressed block data
+		*image_rle,		// RLE-compressed block data
+		*image_delta,		// Delta row-compressed block data or `NULL`
+		*image_seed;		// Last line sent
+  size_t	image_rle_bytes,	// Bytes of RLE-compressed block data
+		image_delta_bytes;	// Bytes of delta row-compressed block data
+  bool		image_seeded;		// Does the printer's seed row match `image_seed`?
+#endif // WITH_PCL6
+};
 
 typedef struct pcl_map_s		// PCL name to code map
 {
@@ -308,6 +469,12 @@ typedef struct pcl_map_s		// PCL name to code map
   int		value;			// Value
 } pcl_map_t;
 
+typedef struct pcl_screen_s		// Halftone screen
+{
+  const char	*keyword;		// "pcl-halftone" value
+  pappl_dither_t threshold;		// Threshold array before gamma correction
+} pcl_screen_t;
+
 
 //
 // Local globals...
@@ -373,25 +540,195 @@ static const char * const pcl_hp_laserjet_media[] =
   "na_monarch_3.875x7.5in"
 };
 
+static const pcl_map_t pcl_compression[] =
+{       // Supported PCL 5 compression modes for each "pcl-compression" value
+  { "adaptive",			(1 << 0) | (1 << 2) | (1 << 3) | (1 << 5) },
+  { "compressed-delta-row",	(1 << 0) | (1 << 2) | (1 << 3) | (1 << 9) },
+  { "delta-row",		(1 << 0) | (1 << 2) | (1 << 3) },
+  { "packbits",			(1 << 0) | (1 << 2) }
+};
+
+static const pcl_screen_t pcl_screens[] =
+{       // Halftone screens for each "pcl-halftone" value other than "blue-noise"
+  {
+    "clustered-dot",			// 45 degree dots, 8 per tile, grown in turn
+    {
+      {  16,  80, 176, 236, 250, 218, 122,  26,  18,  82, 178, 238, 248, 216, 120,  24 },
+      {  96,  88, 148, 156, 164, 210, 114, 106,  98,  90, 150, 158, 166, 208, 112, 104 },
+      { 184, 140,  44,  52,  60,  68, 202, 194, 186, 142,  46,  54,  62,  70, 200, 192 },
+      { 228, 132,  36,   4,  12,  76, 172, 242, 230, 134,  38,   6,  14,  78, 174, 240 },
+      { 252, 220, 124,  28,  20,  84, 180, 233, 254, 222, 126,  30,  22,  86, 182, 235 },
+      { 163, 212, 116, 108, 100,  92, 145, 153, 161, 214, 118, 110, 102,  94, 147, 155 },
+      {  59,  67, 204, 196, 188, 137,  41,  49,  57,  65, 206, 198, 190, 139,  43,  51 },
+      {  11,  75, 171, 244, 225, 129,  33,   1,   9,  73, 169, 246, 227, 131,  35,   3 },
+      {  19,  83, 179, 239, 249, 217, 121,  25,  17,  81, 177, 237, 251, 219, 123,  27 },
+      {  99,  91, 151, 159, 167, 209, 113, 105,  97,  89, 149, 157, 165, 211, 115, 107 },
+      { 187, 143,  47,  55,  63,  71, 201, 193, 185, 141,  45,  53,  61,  69, 203, 195 },
+      { 231, 135,  39,   7,  15,  79, 175, 241, 229, 133,  37,   5,  13,  77, 173, 243 },
+      { 255, 223, 127,  31,  23,  87, 183, 234, 253, 221, 125,  29,  21,  85, 181, 232 },
+      { 160, 215, 119, 111, 103,  95, 146, 154, 162, 213, 117, 109, 101,  93, 144, 152 },
+      {  56,  64, 207, 199, 191, 138,  42,  50,  58,  66, 205, 197, 189, 136,  40,  48 },
+      {   8,  72, 168, 247, 226, 130,  34,   2,  10,  74, 170, 245, 224, 128,  32,   0 }
+    }
+  },
+  {
+    "line",				// Horizontal lines every 4 rows
+    {
+      { 128, 160, 144, 176, 136, 168, 152, 184, 132, 164, 148, 180, 140, 172, 156, 188 },
+      {   0,  32,  16,  48,   8,  40,  24,  56,   4,  36,  20,  52,  12,  44,  28,  60 },
+      {  64,  96,  80, 112,  72, 104,  88, 120,  68, 100,  84, 116,  76, 108,  92, 124 },
+      { 192, 224, 208, 240, 200, 232, 216, 248, 196, 228, 212, 244, 204, 236, 220, 252 },
+      { 130, 162, 146, 178, 138, 170, 154, 186, 134, 166, 150, 182, 142, 174, 158, 190 },
+      {   2,  34,  18,  50,  10,  42,  26,  58,   6,  38,  22,  54,  14,  46,  30,  62 },
+      {  66,  98,  82, 114,  74, 106,  90, 122,  70, 102,  86, 118,  78, 110,  94, 126 },
+      { 194, 226, 210, 242, 202, 234, 218, 250, 198, 230, 214, 246, 206, 238, 222, 254 },
+      { 129, 161, 145, 177, 137, 169, 153, 185, 133, 165, 149, 181, 141, 173, 157, 189 },
+      {   1,  33,  17,  49,   9,  41,  25,  57,   5,  37,  21,  53,  13,  45,  29,  61 },
+      {  65,  97,  81, 113,  73, 105,  89, 121,  69, 101,  85, 117,  77, 109,  93, 125 },
+      { 193, 225, 209, 241, 201, 233, 217, 249, 197, 229, 213, 245, 205, 237, 221, 253 },
+      { 131, 163, 147, 179, 139, 171, 155, 187, 135, 167, 151, 183, 143, 175, 159, 191 },
+      {   3,  35,  19,  51,  11,  43,  27,  59,   7,  39,  23,  55,  15,  47,  31,  63 },
+      {  67,  99,  83, 115,  75, 107,  91, 123,  71, 103,  87, 119,  79, 111,  95, 127 },
+      { 195, 227, 211, 243, 203, 235, 219, 251, 199, 231, 215, 247, 207, 239, 223, 255 }
+    }
+  }
+};
+
+static const pcl_kernels_t *pcl_kernels = NULL;
+					// Vector kernels for this CPU
+static const char *pcl_kernels_bad_isa = NULL;
+					// Unsupported HP_PRINTER_APP_ISA value, if any
+
 
 //
 // Local functions...
 //
 
+static void	pcl_adjust_effort(pappl_job_t *job, pcl_t *pcl);
 static const char *pcl_autoadd(const char *device_info, const char *device_uri, const char *device_id, void *data);
+static void	pcl_band_block(pcl_band_t *band, pcl_worker_t *worker, int command, unsigned count, const unsigned char *data);
+static void	pcl_band_command(pcl_band_t *band, char group, int value, char command);
+static void	pcl_band_encode(pcl_t *pcl, pcl_worker_t *worker, pcl_band_t *band);
+static void	pcl_band_encode_adaptive(pcl_t *pcl, pcl_worker_t *worker, pcl_band_t *band);
+static void	pcl_band_flush(pcl_band_t *band, pcl_worker_t *worker);
+static void	pcl_band_seed(pcl_t *pcl, pcl_worker_t *worker, pcl_band_t *band);
+static void	pcl_band_write(pcl_band_t *band, const void *data, size_t length);
+#ifdef PCL_X86
+static size_t	pcl_blank_avx2(const unsigned char *line, size_t length, unsigned char white) PCL_AVX2;
+#endif // PCL_X86
+static bool	pcl_blank_line(pcl_t *pcl, const unsigned char *pixels);
+#ifdef __ARM_NEON
+static size_t	pcl_blank_neon(const unsigned char *line, size_t length, unsigned char white);
+#endif // __ARM_NEON
+#ifdef PCL_X86
+static size_t	pcl_blank_sse2(const unsigned char *line, size_t length, unsigned char white) PCL_SSE2;
+#endif // PCL_X86
+static void	pcl_cache_8bit(pcl_t *pcl, pcl_worker_t *worker, pcl_cache_t *entry, unsigned y, const unsigned char *pixels);
+static uint64_t	pcl_cache_hash(const unsigned char *data, size_t length, unsigned phase);
+static pcl_cache_t *pcl_cache_line(pcl_t *pcl, pcl_worker_t *worker, unsigned y, const unsigned char *pixels);
 static bool	pcl_callback(pappl_system_t *system, const char *driver_name, const char *device_uri, const char *device_id, pappl_pr_driver_data_t *driver_data, ipp_t **driver_attrs, void *data);
-static void	pcl_compress_data(pcl_t *pcl, pappl_device_t *device, unsigned y, const unsigned char *line, unsigned length, unsigned plane);
+#ifdef PCL_X86
+static size_t	pcl_compare_avx2(const unsigned char *line, const unsigned char *seed, size_t length) PCL_AVX2;
+#endif // PCL_X86
+#ifdef __ARM_NEON
+static size_t	pcl_compare_neon(const unsigned char *line, const unsigned char *seed, size_t length);
+#endif // __ARM_NEON
+#ifdef PCL_X86
+static size_t	pcl_compare_sse2(const unsigned char *line, const unsigned char *seed, size_t length) PCL_SSE2;
+#endif // PCL_X86
+static int	pcl_compress_data(pcl_t *pcl, pcl_worker_t *worker, const unsigned char *line, unsigned length, unsigned plane, const unsigned char *packed, unsigned packed_length, const unsigned char **data, unsigned *datalen);
+static unsigned	pcl_compress_mode3(unsigned char *dst, const unsigned char *line, const unsigned char *seed, unsigned length, unsigned limit);
+static unsigned	pcl_compress_mode9(unsigned char *dst, const unsigned char *line, const unsigned char *seed, unsigned length, unsigned limit);
+static unsigned	pcl_compress_packbits(unsigned char *dst, const unsigned char *line, unsigned length);
+static const char *pcl_compression_default(const char *driver_name, const char *device_id);
+static void	pcl_copy_1bit(pcl_t *pcl, unsigned char *dst, const unsigned char *pixels);
+#ifdef PCL_X86
+static size_t	pcl_copy_1bit_avx2(unsigned char *dst, const unsigned char *src, size_t length, unsigned shift) PCL_AVX2;
+#endif // PCL_X86
+#ifdef __ARM_NEON
+static size_t	pcl_copy_1bit_neon(unsigned char *dst, const unsigned char *src, size_t length, unsigned shift);
+#endif // __ARM_NEON
+#ifdef PCL_X86
+static size_t	pcl_copy_1bit_sse2(unsigned char *dst, const unsigned char *src, size_t length, unsigned shift) PCL_SSE2;
+#endif // PCL_X86
+static void	pcl_dither_8bit(pcl_t *pcl, unsigned char *dst, unsigned y, const unsigned char *pixels, unsigned first, unsigned count, bool black);
+#ifdef PCL_X86
+static unsigned	pcl_dither_8bit_avx2(unsigned char *dst, const unsigned char *src, const unsigned char *dither, unsigned count, bool black) PCL_AVX2;
+#endif // PCL_X86
+#ifdef __ARM_NEON
+static unsigned	pcl_dither_8bit_neon(unsigned char *dst, const unsigned char *src, const unsigned char *dither, unsigned count, bool black);
+#endif // __ARM_NEON
+static void	pcl_dither_8bit_span(unsigned char *dst, const unsigned char *src, const unsigned char *dither, unsigned count, bool black);
+#ifdef PCL_X86
+static unsigned	pcl_dither_8bit_sse2(unsigned char *dst, const unsigned char *src, const unsigned char *dither, unsigned count, bool black) PCL_SSE2;
+#endif // PCL_X86
+static unsigned	pcl_dither_line_rgb(pcl_t *pcl, unsigned char *planes[4], unsigned y, const unsigned char *pixels);
+#ifdef __ARM_NEON
+static unsigned	pcl_dither_rgb_neon(unsigned char *planes[4], const unsigned char *src, const unsigned char *dither, unsigned count, unsigned *used);
+#endif // __ARM_NEON
+static unsigned	pcl_dither_rgb_span(unsigned char *planes[4], const unsigned char *src, const unsigned char *dither, unsigned count);
+#ifdef PCL_X86
+static unsigned	pcl_dither_rgb_sse2(unsigned char *planes[4], const unsigned char *src, const unsigned char *dither, unsigned count, unsigned *used) PCL_SSE2;
+#endif // PCL_X86
+static void	pcl_flat_fill(unsigned char *dst, const unsigned char *pattern, unsigned count);
+static void	pcl_flat_pattern(pcl_t *pcl, unsigned y, unsigned level, bool black, unsigned char pattern[2]);
+static unsigned	pcl_flat_run(const unsigned char *src, unsigned count, unsigned bpp);
+static void	pcl_free_page(pcl_t *pcl);
+static void	pcl_gamma_dither(pappl_dither_t dst, const pappl_dither_t src);
+static void	pcl_kernels_init(void);
+static unsigned	pcl_line_length(const unsigned char *line, unsigned length);
+#ifdef __ARM_NEON
+static inline unsigned pcl_pack_neon(uint8x16_t m);
+#endif // __ARM_NEON
+#ifdef PCL_X86
+static inline unsigned pcl_pack_sse2(__m128i m) PCL_SSE2;
+static size_t	pcl_packbits_avx2(const unsigned char *line, size_t count, bool repeat) PCL_AVX2;
+#endif // PCL_X86
+static unsigned char *pcl_packbits_encode(unsigned char *comp_ptr, unsigned char *comp_end, const unsigned char **line, const unsigned char *line_end, const unsigned char *stop);
+#ifdef __ARM_NEON
+static size_t	pcl_packbits_neon(const unsigned char *line, size_t count, bool repeat);
+#endif // __ARM_NEON
+static unsigned	pcl_packbits_run(const unsigned char *line, unsigned count, bool repeat);
+#ifdef PCL_X86
+static size_t	pcl_packbits_sse2(const unsigned char *line, size_t count, bool repeat) PCL_SSE2;
+#endif // PCL_X86
 static bool	pcl_print(pappl_job_t *job, pappl_pr_options_t *options, pappl_device_t *device);
+static pcl_band_t *pcl_ring_get(pcl_t *pcl);
+static void	pcl_ring_notify(pcl_ring_t *ring);
+static void	pcl_ring_put(pcl_t *pcl);
+static bool	pcl_ring_start(pcl_t *pcl, pappl_device_t *device);
+static bool	pcl_ring_stop(pcl_t *pcl);
+static void	*pcl_ring_thread(pcl_t *pcl);
 static bool	pcl_rendjob(pappl_job_t *job, pappl_pr_options_t *options, pappl_device_t *device);
 static bool	pcl_rendpage(pappl_job_t *job, pappl_pr_options_t *options, pappl_device_t *device, unsigned page);
 static bool	pcl_rstartjob(pappl_job_t *job, pappl_pr_options_t *options, pappl_device_t *device);
 static bool	pcl_rstartpage(pappl_job_t *job, pappl_pr_options_t *options, pappl_device_t *device, unsigned page);
 static bool	pcl_rwriteline(pappl_job_t *job, pappl_pr_options_t *options, pappl_device_t *device, unsigned y, const unsigned char *pixels);
+#ifdef PCL_X86
+static size_t	pcl_snap_avx2(unsigned char *dst, const unsigned char *src, size_t length, unsigned char tolerance) PCL_AVX2;
+#endif // PCL_X86
+static const unsigned char *pcl_snap_line(pcl_t *pcl, const unsigned char *pixels);
+#ifdef __ARM_NEON
+static size_t	pcl_snap_neon(unsigned char *dst, const unsigned char *src, size_t length, unsigned char tolerance);
+#endif // __ARM_NEON
+#ifdef PCL_X86
+static size_t	pcl_snap_sse2(unsigned char *dst, const unsigned char *src, size_t length, unsigned char tolerance) PCL_SSE2;
+#endif // PCL_X86
 static bool	pcl_status(pappl_printer_t *printer);
+static uint64_t	pcl_time(void);
 static bool	pcl_update_status(pappl_printer_t *printer, pappl_device_t *device);
+static void	*pcl_worker_thread(pcl_worker_t *worker);
+static void	pcl_write(pcl_t *pcl, pappl_device_t *device, const void *data, size_t length);
+static void	pcl_write_device(pcl_t *pcl, pappl_device_t *device, const void *data, size_t length);
+static bool	pcl_write_flush(pcl_t *pcl, pappl_device_t *device);
+static bool	pcl_writeline_pcl5(pcl_t *pcl, pappl_device_t *device, unsigned y, const unsigned char *pixels);
+#if WITH_PCL6
+static bool	pcl_writeline_pcl6(pcl_t *pcl, pappl_device_t *device, unsigned y, const unsigned char *pixels);
+#endif // WITH_PCL6
 #if WITH_PCL6
 static void	pcl6_write_command(pappl_device_t *device, enum pcl6_cmd command);
 static void	pcl6_write_data(pappl_device_t *device, const unsigned char *buffer, size_t length);
+static void	pcl6_write_image(pcl_t *pcl, pappl_device_t *device);
 //static void	pcl6_write_string(pappl_device_t *device, const char *s, enum pcl6_attr attr);
 static void	pcl6_write_ubyte(pappl_device_t *device, unsigned n, enum pcl6_attr attr);
 static void	pcl6_write_uint16(pappl_device_t *device, unsigned n, enum pcl6_attr attr);
@@ -408,6 +745,9 @@ int
 main(int  argc,				// I - Number of command-line arguments
      char *argv[])			// I - Command-line arguments
 {
+  // Choose the vector kernels for this CPU...
+  pcl_kernels_init();
+
   return (papplMainloop(argc, argv,
                         VERSION,
                         "Copyright &copy; 2020-2024 by Michael R Sweet. Provided under the terms of the <a href=\"https://www.apache.org/licenses/LICENSE-2.0\">Apache License 2.0</a>.",
@@ -420,6 +760,81 @@ main(int  argc,				// I - Number of command-line arguments
 }
 
 
+//
+// 'pcl_adjust_effort()' - Choose the compression effort for the next page.
+//
+// The band workers and the output thread run in parallel, so a page takes
+// about as long as the slower of the two: the encoding time divided between
+// the workers, or the time spent blocked writing to the device.  The time per
+// line and bytes per line of the last page at each effort are used with the
+// current link speed to estimate the page time for each effort, and an effort
+// that has not been measured yet is tried when it might help - less effort
+// when encoding is the bottleneck and more when the link is.
+//
+
+static void
+pcl_adjust_effort(pappl_job_t *job,	// I - Job
+                  pcl_t       *pcl)	// I - Job data
+{
+  unsigned	i,			// Looping var
+		lines,			// Number of lines encoded
+		effort;			// Next compression effort
+  uint64_t	nsecs;			// Time spent encoding
+  pcl_effort_t	*current;		// Current effort
+  double	cpu_time,		// Estimated encoding time
+		io_time,		// Estimated writing time
+		best_time;		// Estimated page time for best effort
+
+
+  for (i = 0, lines = 0, nsecs = 0; i < pcl->num_workers; i ++)
+  {
+    lines += pcl->workers[i].encode_lines;
+    nsecs += pcl->workers[i].encode_nsecs;
+  }
+
+  if (!lines || !pcl->io_bytes)
+    return;				// Nothing printed
+
+  current                 = pcl->efforts + pcl->effort;
+  current->valid          = true;
+  current->nsecs_per_line = (double)nsecs / lines;
+  current->bytes_per_line = (double)pcl->io_bytes / lines;
+  pcl->io_nsecs_per_byte  = (double)pcl->io_nsecs / pcl->io_bytes;
+
+  cpu_time  = current->nsecs_per_line / pcl->num_workers;
+  io_time   = current->bytes_per_line * pcl->io_nsecs_per_byte;
+  best_time = cpu_time > io_time ? cpu_time : io_time;
+
+  // Look for a measured effort that should be at least 10% faster...
+  for (i = 0, effort = pcl->effort; i <= PCL_MAX_EFFORT; i ++)
+  {
+    double	cpu = pcl->efforts[i].nsecs_per_line / pcl->num_workers,
+		io = pcl->efforts[i].bytes_per_line * pcl->io_nsecs_per_byte,
+		page_time = cpu > io ? cpu : io;
+					// Estimated times for effort
+
+    if (i != pcl->effort && pcl->efforts[i].valid && page_time < 0.9 * best_time)
+    {
+      effort    = i;
+      best_time = page_time;
+    }
+  }
+
+  // Otherwise try an effort we haven't measured...
+  if (effort == pcl->effort)
+  {
+    if (cpu_time > io_time && effort > 0 && !pcl->efforts[effort - 1].valid)
+      effort --;
+    else if (io_time > cpu_time && effort < PCL_MAX_EFFORT && !pcl->efforts[effort + 1].valid)
+      effort ++;
+  }
+
+  papplLogJob(job, PAPPL_LOGLEVEL_DEBUG, "Compression effort %u: %.1fms encoding (%u threads) and %.1fms writing for %u lines (%llu bytes), using effort %u for the next page.", pcl->effort, nsecs / 1000000.0, pcl->num_workers, pcl->io_nsecs / 1000000.0, lines, (unsigned long long)pcl->io_bytes, effort);
+
+  pcl->effort = effort;
+}
+
+
 //
 // 'pcl_autoadd()' - Auto-add PCL printers.
 //
@@ -468,557 +883,3143 @@ pcl_autoadd(const char *device_info,	// I - Device name
 
 
 //
-// 'pcl_callback()' - PCL callback.
+// 'pcl_band_block()' - Add a row command to the adaptive compression block.
+//
+// Commands 0 to 3 carry the number of data bytes that follow, while empty (4)
+// and duplicate (5) row commands carry a row count and are merged with the
+// previous command when possible.  The block is sent whenever the next
+// command does not fit.
 //
 
-static bool				// O - `true` on success, `false` on failure
-pcl_callback(
-    pappl_system_t         *system,	// I - System
-    const char             *driver_name,// I - Driver name
-    const char             *device_uri,	// I - Device URI (not used)
-    const char             *device_id,	// I - IEEE-1284 device ID (not used)
-    pappl_pr_driver_data_t *driver_data,// O - Driver data
-    ipp_t                  **driver_attrs,
-					// O - Driver attributes (not used)
-    void                   *data)	// I - Callback data (not used)
+static void
+pcl_band_block(
+    pcl_band_t          *band,		// I - Band
+    pcl_worker_t        *worker,	// I - Worker
+    int                 command,	// I - Row command
+    unsigned            count,		// I - Number of bytes or rows
+    const unsigned char *data)		// I - Row data or `NULL` for none
 {
-  int   i, j;				// Looping variables
-  static pappl_dither_t	dither =	// Blue-noise dither array
+  unsigned char	*ptr;			// Pointer into block
+  unsigned	rows;			// Number of rows for command
+
+
+  if (command >= 4)
   {
-    { 111,  49, 142, 162, 113, 195,  71, 177, 201,  50, 151,  94,  66,  37,  85, 252 },
-    {  25,  99, 239, 222,  32, 250, 148,  19,  38, 106, 220, 170, 194, 138,  13, 167 },
-    { 125, 178,  79,  15,  65, 173, 123,  87, 213, 131, 247,  23, 116,  54, 229, 212 },
-    {  41, 202, 152, 132, 189, 104,  53, 236, 161,  62,   1, 181,  77, 241, 147,  68 },
-    {   2, 244,  56,  91, 230,   5, 204,  28, 187, 101, 144, 206,  33,  92, 190, 107 },
-    { 223, 164, 114,  36, 214, 156, 139,  70, 245,  84, 226,  48, 126, 158,  17, 135 },
-    {  83, 196,  21, 254,  76,  45, 179, 115,  12,  40, 169, 105, 253, 176, 211,  59 },
-    { 100, 180, 145, 122, 172,  97, 235, 129, 215, 149, 199,   8,  72,  26, 238,  44 },
-    { 232,  31,  69,  11, 205,  58,  18, 193,  88,  60, 112, 221, 140,  86, 120, 153 },
-    { 208, 130, 243, 160, 224, 110,  34, 248, 165,  24, 234, 184,  52, 198, 171,   6 },
-    { 108, 188,  51,  89, 137, 186, 154,  78,  47, 134,  98, 157,  35, 249,  95,  63 },
-    {  16,  75, 219,  39,   0,  67, 228, 121, 197, 240,   3,  74, 127,  20, 227, 143 },
-    { 246, 175, 119, 200, 251, 103, 146,  14, 209, 174, 109, 218, 192,  82, 203, 163 },
-    {  29,  93, 150,  22, 166, 182,  55,  30,  90,  64,  42, 141, 168,  57, 117,  46 },
-    { 216, 233,  61, 128,  81, 237, 217, 118, 159, 255, 185,  27, 242, 102,   4, 133 },
-    {  73, 191,   9, 210,  43,  96,   7, 136, 231,  80,  10, 124, 225, 207, 155, 183 }
-  };
+    while (count > 0)
+    {
+      ptr = worker->block + worker->block_bytes;
+
+      if (worker->block_last == command && (rows = (unsigned)((ptr[-2] << 8) | ptr[-1])) < 65535)
+      {
+        // Add rows to the previous command...
+        if (count > (65535 - rows))
+        {
+          count -= 65535 - rows;
+          rows  = 65535;
+        }
+        else
+        {
+          rows  += count;
+          count = 0;
+        }
+      }
+      else
+      {
+        // Start a new command...
+        if ((worker->block_bytes + 3) > PCL_BLOCK_SIZE)
+        {
+          pcl_band_flush(band, worker);
+          ptr = worker->block;
+        }
 
+        rows  = count > 65535 ? 65535 : count;
+        count -= rows;
 
-  (void)data;
-  (void)device_uri;
-  (void)device_id;
-  (void)driver_attrs;
+        *ptr = (unsigned char)command;
+        ptr += 3;
 
+        worker->block_bytes += 3;
+        worker->block_last  = command;
+      }
 
-  // Set dither arrays...
-  for (i = 0; i < 16; i ++)
+      ptr[-2] = (unsigned char)(rows >> 8);
+      ptr[-1] = (unsigned char)rows;
+    }
+  }
+  else
   {
-    // Apply gamma correction to dither array...
-    for (j = 0; j < 16; j ++)
-      driver_data->gdither[i][j] = 255 - (int)(255.0 * pow(1.0 - dither[i][j] / 255.0, 0.4545));
+    if ((worker->block_bytes + 3 + count) > PCL_BLOCK_SIZE)
+      pcl_band_flush(band, worker);
+
+    ptr    = worker->block + worker->block_bytes;
+    *ptr++ = (unsigned char)command;
+    *ptr++ = (unsigned char)(count >> 8);
+    *ptr++ = (unsigned char)count;
+
+    memcpy(ptr, data, count);
+
+    worker->block_bytes += 3 + count;
+    worker->block_last  = command;
   }
+}
 
-  // Same dither array for photo as well...
-  memcpy(driver_data->pdither, driver_data->gdither, sizeof(driver_data->pdither));
 
-  /* Set callbacks */
-  driver_data->printfile_cb  = pcl_print;
-  driver_data->rendjob_cb    = pcl_rendjob;
-  driver_data->rendpage_cb   = pcl_rendpage;
-  driver_data->rstartjob_cb  = pcl_rstartjob;
-  driver_data->rstartpage_cb = pcl_rstartpage;
-  driver_data->rwriteline_cb = pcl_rwriteline;
-  driver_data->status_cb     = pcl_status;
-  driver_data->has_supplies  = true;
+//
+// 'pcl_band_command()' - Add a "\033*<group><value><command>" sequence to a
+//                        band.
+//
 
-  /* Native format */
-  driver_data->format = "application/vnd.hp-pcl";
+static void
+pcl_band_command(
+    pcl_band_t *band,			// I - Band
+    char       group,			// I - Group character
+    int        value,			// I - Value
+    char       command)			// I - Command character
+{
+  unsigned char	*bufptr = band->out_buffer + band->out_bytes,
+					// Pointer into output buffer
+		digits[10],		// Digits (reversed)
+		*digptr = digits;	// Pointer into digits
+  unsigned	n;			// Value magnitude
 
-  /* Default orientation and quality */
-  driver_data->orient_default  = IPP_ORIENT_NONE;
-  driver_data->quality_default = IPP_QUALITY_NORMAL;
 
-  if (!strcmp(driver_name, "hp_deskjet"))
+  *bufptr++ = 0x1b;
+  *bufptr++ = '*';
+  *bufptr++ = (unsigned char)group;
+
+  if (value < 0)
   {
-    /* Make and model name */
-    papplCopyString(driver_data->make_and_model, "HP DeskJet series", sizeof(driver_data->make_and_model));
+    *bufptr++ = '-';
+    n         = 0U - (unsigned)value;
+  }
+  else
+    n = (unsigned)value;
 
-    /* Icons */
-    driver_data->icons[0].data    = hp_deskjet_sm_png;
-    driver_data->icons[0].datalen = sizeof(hp_deskjet_sm_png);
+  do
+  {
+    *digptr++ = (unsigned char)('0' + n % 10);
+    n /= 10;
+  }
+  while (n > 0);
 
-    driver_data->icons[1].data    = hp_deskjet_md_png;
-    driver_data->icons[1].datalen = sizeof(hp_deskjet_md_png);
+  while (digptr > digits)
+    *bufptr++ = *--digptr;
 
-    driver_data->icons[2].data    = hp_deskjet_lg_png;
-    driver_data->icons[2].datalen = sizeof(hp_deskjet_lg_png);
+  *bufptr++ = (unsigned char)command;
 
-    /* Pages-per-minute for monochrome and color */
-    driver_data->ppm       = 8;
-    driver_data->ppm_color = 2;
+  band->out_bytes = (size_t)(bufptr - band->out_buffer);
+}
 
-    /* Three resolutions - 150dpi, 300dpi (default), and 600dpi */
-    driver_data->num_resolution  = 3;
-    driver_data->x_resolution[0] = 150;
-    driver_data->y_resolution[0] = 150;
-    driver_data->x_resolution[1] = 300;
-    driver_data->y_resolution[1] = 300;
-    driver_data->x_resolution[2] = 600;
-    driver_data->y_resolution[2] = 600;
-    driver_data->x_default = driver_data->y_default = 300;
 
-    /* Four color spaces - black (1-bit and 8-bit), grayscale, and sRGB */
-    driver_data->raster_types = PAPPL_PWG_RASTER_TYPE_BLACK_1 | PAPPL_PWG_RASTER_TYPE_BLACK_8 | PAPPL_PWG_RASTER_TYPE_SGRAY_8 | PAPPL_PWG_RASTER_TYPE_SRGB_8;
+//
+// 'pcl_band_encode()' - Dither and compress a band of lines.
+//
+// Each band is encoded independently - the seed rows are rebuilt from the line
+// before the band and the compression mode is always set for the first line -
+// so that bands can be encoded in any order and sent in page order.
+//
 
-    /* Color modes: auto (default), monochrome, and color */
-    driver_data->color_supported = PAPPL_COLOR_MODE_AUTO | PAPPL_COLOR_MODE_AUTO_MONOCHROME | PAPPL_COLOR_MODE_COLOR | PAPPL_COLOR_MODE_MONOCHROME;
-    driver_data->color_default   = PAPPL_COLOR_MODE_AUTO;
+static void
+pcl_band_encode(pcl_t        *pcl,	// I - Job data
+                pcl_worker_t *worker,	// I - Worker
+                pcl_band_t   *band)	// I - Band
+{
+  unsigned		i,		// Looping var
+			plane,		// Current plane
+			num_planes,	// Number of planes to send
+			count;		// Number of compressed bytes
+  int			comp;		// Compression mode
+  const unsigned char	*data;		// Compressed data
+  pcl_cache_t		*entry;		// Dithered line
 
-    /* Media sizes with 1/4" left/right and 1/2" top/bottom margins*/
-    driver_data->num_media = (int)(sizeof(pcl_hp_deskjet_media) / sizeof(pcl_hp_deskjet_media[0]));
-    memcpy(driver_data->media, pcl_hp_deskjet_media, sizeof(pcl_hp_deskjet_media));
 
-    driver_data->left_right = 635;	 // 1/4" left and right
-    driver_data->bottom_top = 1270;	 // 1/2" top and bottom
+  band->out_bytes = 0;
 
-    /* 1-sided printing only */
-    driver_data->sides_supported = PAPPL_SIDES_ONE_SIDED;
-    driver_data->sides_default   = PAPPL_SIDES_ONE_SIDED;
+  pcl_band_seed(pcl, worker, band);
 
-    /* Three paper trays (MSN names) */
-    driver_data->num_source = 3;
-    driver_data->source[0]  = "tray-1";
-    driver_data->source[1]  = "manual";
-    driver_data->source[2]  = "envelope";
+  worker->compression = -1;
 
-    /* Media types (MSN names) */
-    driver_data->num_type = 8;
-    driver_data->type[0]  = "stationery";
-    driver_data->type[1]  = "stationery-inkjet";
-    driver_data->type[2]  = "stationery-letterhead";
-    driver_data->type[3]  = "cardstock";
-    driver_data->type[4]  = "labels";
-    driver_data->type[5]  = "envelope";
-    driver_data->type[6]  = "transparency";
-    driver_data->type[7]  = "photographic";
-  }
-  else if (!strcmp(driver_name, "hp_generic"))
+  for (i = 0; i < band->num_lines; i ++)
   {
-    /* Make and model name */
-    papplCopyString(driver_data->make_and_model, "Generic PCL 5", sizeof(driver_data->make_and_model));
+    // Skip blank lines as needed...
+    if (band->feed[i] > 0)
+    {
+      pcl_band_command(band, 'b', (int)band->feed[i], 'Y');
 
-    /* Icons */
-    driver_data->icons[0].data    = hp_generic_sm_png;
-    driver_data->icons[0].datalen = sizeof(hp_generic_sm_png);
+      // Raster Y offset also clears the seed rows...
+      memset(worker->seed[0], 0, pcl->num_planes * pcl->linesize);
+      memset(worker->seed_length, 0, sizeof(worker->seed_length));
+    }
 
-    driver_data->icons[1].data    = hp_generic_md_png;
-    driver_data->icons[1].datalen = sizeof(hp_generic_md_png);
+    // Dither (or reuse a cached copy of) and compress the line...
+    entry = pcl_cache_line(pcl, worker, band->y[i], band->pixels + (i + 1) * pcl->bytes_per_line);
 
-    driver_data->icons[2].data    = hp_generic_lg_png;
-    driver_data->icons[2].datalen = sizeof(hp_generic_lg_png);
+    // Send neutral (black-only) color lines as a single K plane - the printer
+    // fills the missing planes with zeros, which matches the seed rows only
+    // when those are empty or unused...
+    num_planes = pcl->num_planes;
 
-    /* Pages-per-minute for monochrome and color */
-    driver_data->ppm = 10;
+    if (num_planes == 4 && !(entry->lengths[1] | entry->lengths[2] | entry->lengths[3]) && (!(pcl->page_modes & ((1 << 3) | (1 << 9))) || !(worker->seed_length[1] | worker->seed_length[2] | worker->seed_length[3])))
+    {
+      num_planes = 1;
+      worker->black_lines ++;
+    }
 
-    /* Two resolutions - 300dpi (default) and 600dpi */
-    driver_data->num_resolution  = 2;
-    driver_data->x_resolution[0] = 300;
-    driver_data->y_resolution[0] = 300;
-    driver_data->x_resolution[1] = 600;
-    driver_data->y_resolution[1] = 600;
-    driver_data->x_default = driver_data->y_default = 300;
+    for (plane = 0; plane < num_planes; plane ++)
+    {
+      comp = pcl_compress_data(pcl, worker, entry->planes[plane], entry->lengths[plane], plane, entry->packed[plane], entry->packed_lengths[plane], &data, &count);
 
-    driver_data->raster_types = PAPPL_PWG_RASTER_TYPE_BLACK_1 | PAPPL_PWG_RASTER_TYPE_BLACK_8 | PAPPL_PWG_RASTER_TYPE_SGRAY_8;
+      // Set compression mode as needed...
+      if (worker->compression != comp)
+      {
+	worker->compression = comp;
+	pcl_band_command(band, 'b', comp, 'M');
+      }
 
-    driver_data->color_supported = PAPPL_COLOR_MODE_MONOCHROME;
-    driver_data->color_default   = PAPPL_COLOR_MODE_MONOCHROME;
+      // Set the length of the data and write a raster plane...
+      pcl_band_command(band, 'b', (int)count, plane < (num_planes - 1) ? 'V' : 'W');
+      pcl_band_write(band, data, count);
+    }
+  }
+}
 
-    driver_data->num_media = (int)(sizeof(pcl_generic_pcl_media) / sizeof(pcl_generic_pcl_media[0]));
-    memcpy(driver_data->media, pcl_generic_pcl_media, sizeof(pcl_generic_pcl_media));
 
-    driver_data->sides_supported = PAPPL_SIDES_ONE_SIDED | PAPPL_SIDES_TWO_SIDED_LONG_EDGE | PAPPL_SIDES_TWO_SIDED_SHORT_EDGE;
-    driver_data->sides_default   = PAPPL_SIDES_ONE_SIDED;
+//
+// 'pcl_band_encode_adaptive()' - Dither and compress a band of lines using
+//                                adaptive compression.
+//
+// Adaptive compression (mode 5) sends the band as blocks of row commands,
+// choosing uncompressed, PackBits, or delta row data for each line and using
+// row counts for blank and repeated lines, so no raster Y offset or
+// compression mode changes are needed.  Only one plane is supported.
+//
 
-    driver_data->num_source = 7;
-    driver_data->source[0]  = "default";
-    driver_data->source[1]  = "tray-1";
-    driver_data->source[2]  = "tray-2";
-    driver_data->source[3]  = "tray-3";
-    driver_data->source[4]  = "tray-4";
-    driver_data->source[5]  = "manual";
-    driver_data->source[6]  = "envelope";
+static void
+pcl_band_encode_adaptive(
+    pcl_t        *pcl,			// I - Job data
+    pcl_worker_t *worker,		// I - Worker
+    pcl_band_t   *band)			// I - Band
+{
+  unsigned		i,		// Looping var
+			length,		// Length of line
+			seed_length,	// Length to compare with the seed row
+			count,		// Number of delta row bytes
+			best;		// Size of best compression so far
+  int			comp;		// Row command
+  const unsigned char	*data;		// Row data
+  pcl_cache_t		*entry;		// Dithered line
 
-    /* Media types (MSN names) */
-    driver_data->num_type = 6;
-    driver_data->type[0]  = "stationery";
-    driver_data->type[1]  = "stationery-letterhead";
-    driver_data->type[2]  = "cardstock";
-    driver_data->type[3]  = "labels";
-    driver_data->type[4]  = "envelope";
-    driver_data->type[5]  = "transparency";
 
-    driver_data->left_right = 635;	// 1/4" left and right
-    driver_data->bottom_top = 423;	// 1/6" top and bottom
+  band->out_bytes     = 0;
+  worker->block_bytes = 0;
+  worker->block_last  = -1;
 
-    for (i = 0; i < driver_data->num_source; i ++)
-    {
-      if (strcmp(driver_data->source[i], "envelope"))
-        snprintf(driver_data->media_ready[i].size_name, sizeof(driver_data->media_ready[i].size_name), "na_letter_8.5x11in");
-      else
-        snprintf(driver_data->media_ready[i].size_name, sizeof(driver_data->media_ready[i].size_name), "env_10_4.125x9.5in");
-    }
-  }
-#if WITH_PCL6
-  else if (!strncmp(driver_name, "hp_generic6", 11))
-  {
-    // Native format...
-    driver_data->format = "application/vnd.hp-pclxl";
-
-    /* Make and model name */
-    if (driver_name[11] == 'c')
-      papplCopyString(driver_data->make_and_model, "Generic PCL 6 Color", sizeof(driver_data->make_and_model));
-    else
-      papplCopyString(driver_data->make_and_model, "Generic PCL 6 Monochrome", sizeof(driver_data->make_and_model));
+  pcl_band_seed(pcl, worker, band);
+  pcl_band_command(band, 'b', 5, 'M');
 
-    /* Icons */
-    driver_data->icons[0].data    = hp_generic_sm_png;
-    driver_data->icons[0].datalen = sizeof(hp_generic_sm_png);
+  for (i = 0; i < band->num_lines; i ++)
+  {
+    // Skip blank lines as needed - empty rows also clear the seed row...
+    if (band->feed[i] > 0)
+    {
+      pcl_band_block(band, worker, 4, band->feed[i], NULL);
 
-    driver_data->icons[1].data    = hp_generic_md_png;
-    driver_data->icons[1].datalen = sizeof(hp_generic_md_png);
+      memset(worker->seed[0], 0, worker->seed_length[0]);
+      worker->seed_length[0] = 0;
+    }
 
-    driver_data->icons[2].data    = hp_generic_lg_png;
-    driver_data->icons[2].datalen = sizeof(hp_generic_lg_png);
+    // Dither (or reuse a cached copy of) the line...
+    entry  = pcl_cache_line(pcl, worker, band->y[i], band->pixels + (i + 1) * pcl->bytes_per_line);
+    length = entry->lengths[0];
 
-    /* Pages-per-minute for monochrome and color */
-    driver_data->ppm = 10;
+    if (!length)
+    {
+      // Line is white after dithering...
+      pcl_band_block(band, worker, 4, 1, NULL);
 
-    /* Two resolutions - 300dpi (default) and 600dpi */
-    driver_data->num_resolution  = 2;
-    driver_data->x_resolution[0] = 300;
-    driver_data->y_resolution[0] = 300;
-    driver_data->x_resolution[1] = 600;
-    driver_data->y_resolution[1] = 600;
-    driver_data->x_default = driver_data->y_default = 300;
+      memset(worker->seed[0], 0, worker->seed_length[0]);
+      worker->seed_length[0] = 0;
+      continue;
+    }
 
-    if (driver_name[11] == 'c')
+    if (length == worker->seed_length[0] && !memcmp(entry->planes[0], worker->seed[0], length))
     {
-      /* Four color spaces - black (1-bit and 8-bit), grayscale, and sRGB */
-      driver_data->raster_types = PAPPL_PWG_RASTER_TYPE_BLACK_1 | PAPPL_PWG_RASTER_TYPE_BLACK_8 | PAPPL_PWG_RASTER_TYPE_SGRAY_8 | PAPPL_PWG_RASTER_TYPE_SRGB_8;
-
-      /* Color modes: auto (default), monochrome, and color */
-      driver_data->color_supported = PAPPL_COLOR_MODE_AUTO | PAPPL_COLOR_MODE_AUTO_MONOCHROME | PAPPL_COLOR_MODE_COLOR | PAPPL_COLOR_MODE_MONOCHROME;
-      driver_data->color_default   = PAPPL_COLOR_MODE_AUTO;
+      // Line repeats the previous one...
+      pcl_band_block(band, worker, 5, 1, NULL);
+      continue;
+    }
 
-      driver_data->ppm_color = 10;
+    // Use the smallest of the uncompressed, PackBits, and delta row data...
+    if (entry->packed_lengths[0] < length)
+    {
+      comp = 2;
+      data = entry->packed[0];
+      best = entry->packed_lengths[0];
     }
     else
     {
-      /* Three color spaces - black (1-bit and 8-bit) and grayscale */
-      driver_data->raster_types = PAPPL_PWG_RASTER_TYPE_BLACK_1 | PAPPL_PWG_RASTER_TYPE_BLACK_8 | PAPPL_PWG_RASTER_TYPE_SGRAY_8;
+      comp = 0;
+      data = entry->planes[0];
+      best = length;
+    }
 
-      /* Color modes: monochrome */
-      driver_data->color_supported = PAPPL_COLOR_MODE_MONOCHROME;
-      driver_data->color_default   = PAPPL_COLOR_MODE_MONOCHROME;
+    if ((seed_length = worker->seed_length[0]) < length)
+      seed_length = length;
+
+    if ((pcl->page_modes & (1 << 3)) && (count = pcl_compress_mode3(worker->delta_buffer, entry->planes[0], worker->seed[0], seed_length, best)) < best)
+    {
+      comp = 3;
+      data = worker->delta_buffer;
+      best = count;
     }
 
-    driver_data->num_media = (int)(sizeof(pcl_generic_pcl_media) / sizeof(pcl_generic_pcl_media[0]));
-    memcpy(driver_data->media, pcl_generic_pcl_media, sizeof(pcl_generic_pcl_media));
+    pcl_band_block(band, worker, comp, best, data);
 
-    driver_data->sides_supported = PAPPL_SIDES_ONE_SIDED | PAPPL_SIDES_TWO_SIDED_LONG_EDGE | PAPPL_SIDES_TWO_SIDED_SHORT_EDGE;
-    driver_data->sides_default   = PAPPL_SIDES_ONE_SIDED;
+    // The printer's seed row is now the current line...
+    memcpy(worker->seed[0], entry->planes[0], seed_length);
+    worker->seed_length[0] = length;
+  }
 
-    driver_data->num_source = 7;
-    driver_data->source[0]  = "default";
-    driver_data->source[1]  = "tray-1";
-    driver_data->source[2]  = "tray-2";
-    driver_data->source[3]  = "tray-3";
-    driver_data->source[4]  = "tray-4";
-    driver_data->source[5]  = "manual";
-    driver_data->source[6]  = "envelope";
+  pcl_band_flush(band, worker);
+}
 
-    /* Media types (MSN names) */
-    driver_data->num_type = 6;
-    driver_data->type[0]  = "stationery";
-    driver_data->type[1]  = "stationery-letterhead";
-    driver_data->type[2]  = "cardstock";
-    driver_data->type[3]  = "labels";
-    driver_data->type[4]  = "envelope";
-    driver_data->type[5]  = "transparency";
 
-    driver_data->left_right = 423;	// 1/6" left and right
-    driver_data->bottom_top = 423;	// 1/6" top and bottom
+//
+// 'pcl_band_flush()' - Send the adaptive compression block for a band.
+//
 
-    for (i = 0; i < driver_data->num_source; i ++)
-    {
-      if (strcmp(driver_data->source[i], "envelope"))
-        snprintf(driver_data->media_ready[i].size_name, sizeof(driver_data->media_ready[i].size_name), "na_letter_8.5x11in");
-      else
-        snprintf(driver_data->media_ready[i].size_name, sizeof(driver_data->media_ready[i].size_name), "env_10_4.125x9.5in");
-    }
+static void
+pcl_band_flush(pcl_band_t   *band,	// I - Band
+               pcl_worker_t *worker)	// I - Worker
+{
+  if (worker->block_bytes > 0)
+  {
+    pcl_band_command(band, 'b', (int)worker->block_bytes, 'W');
+    pcl_band_write(band, worker->block, worker->block_bytes);
   }
-#endif // WITH_PCL6
-  else if (!strcmp(driver_name, "hp_laserjet"))
+
+  worker->block_bytes = 0;
+  worker->block_last  = -1;
+}
+
+
+//
+// 'pcl_band_seed()' - Set the seed rows for the first line in a band.
+//
+// The printer's seed rows hold the previous line unless there is a skip.
+//
+
+static void
+pcl_band_seed(pcl_t        *pcl,	// I - Job data
+              pcl_worker_t *worker,	// I - Worker
+              pcl_band_t   *band)	// I - Band
+{
+  pcl_cache_t	*entry;			// Dithered line
+
+
+  if (band->has_prev && !band->feed[0])
   {
-    /* Make and model name */
-    papplCopyString(driver_data->make_and_model, "HP LaserJet series", sizeof(driver_data->make_and_model));
+    entry = pcl_cache_line(pcl, worker, band->prev_y, band->pixels);
 
-    /* Icons */
-    driver_data->icons[0].data    = hp_laserjet_sm_png;
-    driver_data->icons[0].datalen = sizeof(hp_laserjet_sm_png);
+    memcpy(worker->seed[0], entry->planes[0], pcl->num_planes * pcl->linesize);
+    memcpy(worker->seed_length, entry->lengths, sizeof(worker->seed_length));
+  }
+  else
+  {
+    memset(worker->seed[0], 0, pcl->num_planes * pcl->linesize);
+    memset(worker->seed_length, 0, sizeof(worker->seed_length));
+  }
+}
 
-    driver_data->icons[1].data    = hp_laserjet_md_png;
-    driver_data->icons[1].datalen = sizeof(hp_laserjet_md_png);
 
-    driver_data->icons[2].data    = hp_laserjet_lg_png;
-    driver_data->icons[2].datalen = sizeof(hp_laserjet_lg_png);
+//
+// 'pcl_band_write()' - Add data to a band.
+//
+// Band output buffers are allocated for the worst case, so no bounds checking
+// is needed.
+//
 
-    /* Pages-per-minute for monochrome and color */
-    driver_data->ppm = 10;
+static void
+pcl_band_write(pcl_band_t *band,	// I - Band
+               const void *data,	// I - Data
+               size_t     length)	// I - Number of bytes
+{
+  memcpy(band->out_buffer + band->out_bytes, data, length);
+  band->out_bytes += length;
+}
 
-    /* Three resolutions - 150dpi, 300dpi (default), and 600dpi */
-    driver_data->num_resolution  = 3;
-    driver_data->x_resolution[0] = 150;
-    driver_data->y_resolution[0] = 150;
-    driver_data->x_resolution[1] = 300;
-    driver_data->y_resolution[1] = 300;
-    driver_data->x_resolution[2] = 600;
-    driver_data->y_resolution[2] = 600;
-    driver_data->x_default = driver_data->y_default = 300;
 
-    driver_data->raster_types = PAPPL_PWG_RASTER_TYPE_BLACK_1 | PAPPL_PWG_RASTER_TYPE_BLACK_8 | PAPPL_PWG_RASTER_TYPE_SGRAY_8;
+#ifdef PCL_X86
+//
+// 'pcl_blank_avx2()' - Count leading white bytes using AVX2.
+//
 
-    driver_data->color_supported = PAPPL_COLOR_MODE_MONOCHROME;
-    driver_data->color_default   = PAPPL_COLOR_MODE_MONOCHROME;
+PCL_AVX2
+static size_t				// O - Number of white bytes found
+pcl_blank_avx2(
+    const unsigned char *line,		// I - Line
+    size_t              length,		// I - Number of bytes
+    unsigned char       white)		// I - White value
+{
+  size_t	i;			// Current byte
+  const __m256i	w256 = _mm256_set1_epi8((char)white);
+					// White pixels
 
-    driver_data->num_media = (int)(sizeof(pcl_hp_laserjet_media) / sizeof(pcl_hp_laserjet_media[0]));
-    memcpy(driver_data->media, pcl_hp_laserjet_media, sizeof(pcl_hp_laserjet_media));
 
-    driver_data->sides_supported = PAPPL_SIDES_ONE_SIDED | PAPPL_SIDES_TWO_SIDED_LONG_EDGE | PAPPL_SIDES_TWO_SIDED_SHORT_EDGE;
-    driver_data->sides_default   = PAPPL_SIDES_ONE_SIDED;
+  // 32 bytes at a time, then let SSE2 do the rest...
+  for (i = 0; (i + 32) <= length; i += 32)
+  {
+    __m256i v = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(line + i)), w256);
 
-    driver_data->num_source = 7;
-    driver_data->source[0]  = "default";
-    driver_data->source[1]  = "tray-1";
-    driver_data->source[2]  = "tray-2";
-    driver_data->source[3]  = "tray-3";
-    driver_data->source[4]  = "tray-4";
-    driver_data->source[5]  = "manual";
-    driver_data->source[6]  = "envelope";
+    if (!_mm256_testz_si256(v, v))
+      return (i);
+  }
 
-    /* Media types (MSN names) */
-    driver_data->num_type = 6;
-    driver_data->type[0]  = "stationery";
-    driver_data->type[1]  = "stationery-letterhead";
-    driver_data->type[2]  = "cardstock";
-    driver_data->type[3]  = "labels";
-    driver_data->type[4]  = "envelope";
-    driver_data->type[5]  = "transparency";
+  return (i + pcl_blank_sse2(line + i, length - i, white));
+}
+#endif // PCL_X86
 
-    driver_data->left_right = 635;	// 1/4" left and right
-    driver_data->bottom_top = 423;	// 1/6" top and bottom
 
-    for (i = 0; i < driver_data->num_source; i ++)
+//
+// 'pcl_blank_line()' - Check whether the printable area of a line is blank.
+//
+// Only the columns from `xstart` to `xend` are checked, since the margins are
+// never printed.  Each byte is XOR'd with the white value for the color space
+// so that the vector unit can test whole vectors against zero.
+//
+
+static bool				// O - `true` if blank, `false` otherwise
+pcl_blank_line(
+    pcl_t               *pcl,		// I - Job data
+    const unsigned char *pixels)	// I - Line
+{
+  const unsigned char	*ptr,		// Pointer into line
+			*end;		// End of printable area
+  unsigned char		white = pcl->color_space == CUPS_CSPACE_K ? 0 : 255;
+					// White value
+
+
+  if (pcl->bits_per_pixel == 1)
+  {
+    // Check the partial bytes at the edges of the printable area...
+    ptr = pixels + pcl->xstart / 8;
+    end = pixels + pcl->xend / 8;
+
+    if ((pcl->xend & 7) && ((*end ^ white) & (unsigned char)(0xff00 >> (pcl->xend & 7))))
+      return (false);
+
+    if (pcl->xstart & 7)
     {
-      if (strcmp(driver_data->source[i], "envelope"))
-        snprintf(driver_data->media_ready[i].size_name, sizeof(driver_data->media_ready[i].size_name), "na_letter_8.5x11in");
-      else
-        snprintf(driver_data->media_ready[i].size_name, sizeof(driver_data->media_ready[i].size_name), "env_10_4.125x9.5in");
+      if ((*ptr ^ white) & (0xff >> (pcl->xstart & 7)))
+        return (false);
+
+      ptr ++;
     }
   }
   else
   {
-    papplLog(system, PAPPL_LOGLEVEL_ERROR, "Driver name '%s' not supported.", driver_name);
-    return (false);
+    ptr = pixels + pcl->xstart * pcl->bits_per_pixel / 8;
+    end = pixels + pcl->xend * pcl->bits_per_pixel / 8;
   }
 
-  // Fill out ready and default media (default == ready media from the first source)
-  for (i = 0; i < driver_data->num_source; i ++)
+  // Check whole vectors and then any remaining bytes...
+  if (ptr < end && pcl_kernels->blank)
+    ptr += (pcl_kernels->blank)(ptr, (size_t)(end - ptr), white);
+
+  for (; ptr < end; ptr ++)
   {
-    pwg_media_t *pwg;			/* Media size information */
+    if (*ptr != white)
+      return (false);
+  }
 
-    /* Use US Letter for regular trays, #10 envelope for the envelope tray */
-    if (!strcmp(driver_data->source[i], "envelope"))
-      papplCopyString(driver_data->media_ready[i].size_name, "na_number-10_4.125x9.5in", sizeof(driver_data->media_ready[i].size_name));
-    else
-      papplCopyString(driver_data->media_ready[i].size_name, "na_letter_8.5x11in", sizeof(driver_data->media_ready[i].size_name));
+  return (true);
+}
 
-    /* Set margin and size information */
-    if ((pwg = pwgMediaForPWG(driver_data->media_ready[i].size_name)) != NULL)
-    {
-      driver_data->media_ready[i].bottom_margin = driver_data->bottom_top;
-      driver_data->media_ready[i].left_margin   = driver_data->left_right;
-      driver_data->media_ready[i].right_margin  = driver_data->left_right;
-      driver_data->media_ready[i].size_width    = pwg->width;
-      driver_data->media_ready[i].size_length   = pwg->length;
-      driver_data->media_ready[i].top_margin    = driver_data->bottom_top;
-      papplCopyString(driver_data->media_ready[i].source, driver_data->source[i], sizeof(driver_data->media_ready[i].source));
-      papplCopyString(driver_data->media_ready[i].type, driver_data->type[0],  sizeof(driver_data->media_ready[i].type));
-    }
+
+#ifdef __ARM_NEON
+//
+// 'pcl_blank_neon()' - Count leading white bytes using NEON.
+//
+
+static size_t				// O - Number of white bytes found
+pcl_blank_neon(
+    const unsigned char *line,		// I - Line
+    size_t              length,		// I - Number of bytes
+    unsigned char       white)		// I - White value
+{
+  size_t	i;			// Current byte
+  const uint8x16_t w128 = vdupq_n_u8(white);
+					// White pixels
+
+
+  // 16 bytes at a time...
+  for (i = 0; (i + 16) <= length; i += 16)
+  {
+    uint64x2_t v = vreinterpretq_u64_u8(veorq_u8(vld1q_u8(line + i), w128));
+
+    if (vgetq_lane_u64(v, 0) | vgetq_lane_u64(v, 1))
+      break;
   }
 
-  driver_data->media_default = driver_data->media_ready[0];
+  return (i);
+}
+#endif // __ARM_NEON
 
-  return (true);
+
+#ifdef PCL_X86
+//
+// 'pcl_blank_sse2()' - Count leading white bytes using SSE2.
+//
+
+PCL_SSE2
+static size_t				// O - Number of white bytes found
+pcl_blank_sse2(
+    const unsigned char *line,		// I - Line
+    size_t              length,		// I - Number of bytes
+    unsigned char       white)		// I - White value
+{
+  size_t	i;			// Current byte
+  const __m128i	w128 = _mm_set1_epi8((char)white);
+					// White pixels
+
+
+  // 16 bytes at a time...
+  for (i = 0; (i + 16) <= length; i += 16)
+  {
+    unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(line + i)), w128));
+
+    if (mask != 0xffff)
+      return (i + (size_t)__builtin_ctz(~mask));
+  }
+
+  return (i);
 }
+#endif // PCL_X86
 
 
 //
-// 'pcl_compress_data()' - Compress a line of graphics.
+// 'pcl_cache_8bit()' - Dither and compress an 8-bit black or gray line.
+//
+// The line is processed in tiles of `PCL_TILE_SIZE` pixels.  Each tile is
+// copied to the cache entry, dithered, checked for trailing white space, and
+// PackBits-compressed while it is still in the CPU cache, so the source line
+// is only read from memory once more after hashing.  The PackBits encoder
+// stays 128 bytes behind the last non-white byte until the end of the line so
+// the output is the same as compressing the whole line.
 //
 
 static void
-pcl_compress_data(
+pcl_cache_8bit(
     pcl_t               *pcl,		// I - Job data
-    pappl_device_t      *device,	// I - Device
+    pcl_worker_t        *worker,	// I - Worker
+    pcl_cache_t         *entry,		// I - Cache entry
     unsigned            y,		// I - Line number
-    const unsigned char *line,		// I - Data to compress
-    unsigned            length,		// I - Number of bytes
-    unsigned            plane)		// I - Color plane
+    const unsigned char *pixels)	// I - Line
 {
-  const unsigned char	*line_ptr,	// Current byte pointer
-			*line_end,	// End-of-line byte pointer
-			*start;		// Start of compression sequence
-  unsigned char		*comp_ptr;	// Pointer into compression buffer
-  unsigned		count;		// Count of bytes for output
-  int			comp;		// Current compression type
+  unsigned		x,		// Current column
+			count,		// Number of columns in tile
+			bytes,		// Number of bytes in tile
+			length = 0;	// Length of line without trailing zeros
+  const unsigned char	*src = pixels + pcl->xstart;
+					// Printable area of line
+  unsigned char		*dst = entry->planes[0],
+					// Output bitmap
+			*comp_ptr = NULL;
+					// End of compressed data, if any
+  const unsigned char	*comp_line = dst;
+					// Next byte to compress
+  bool			black = pcl->color_space == CUPS_CSPACE_K;
+					// Black or gray?
+
+
+  if (pcl->page_modes & (1 << 2))
+    comp_ptr = worker->comp_buffer;
+
+  for (x = 0; x < pcl->width; x += count)
+  {
+    if ((count = pcl->width - x) > PCL_TILE_SIZE)
+      count = PCL_TILE_SIZE;
 
+    bytes = (count + 7) / 8;
 
-  // Try doing TIFF PackBits compression...
-  line_ptr = line;
-  line_end = line + length;
-  comp_ptr = pcl->comp_buffer;
+    memcpy(entry->pixels + x, src + x, count);
+    memset(dst + x / 8, 0, bytes);
 
-  while (line_ptr < line_end)
-  {
-    if ((line_ptr + 1) >= line_end)
-    {
-      // Single byte on the end...
-      *comp_ptr++ = 0x00;
-      *comp_ptr++ = *line_ptr++;
+    pcl_dither_8bit(pcl, dst, y, pixels, x, count, black);
+
+    if ((bytes = pcl_line_length(dst + x / 8, bytes)) > 0)
+      length = x / 8 + bytes;
+
+    // Compress what is safe so far, giving up once the output is longer than
+    // any line could be...
+    if (comp_ptr && length > 128)
+      comp_ptr = pcl_packbits_encode(comp_ptr, worker->comp_buffer + pcl->linesize, &comp_line, dst + length, dst + length - 128);
+  }
+
+  entry->lengths[0] = length;
+
+  if (comp_ptr)
+    comp_ptr = pcl_packbits_encode(comp_ptr, worker->comp_buffer + length, &comp_line, dst + length, dst + length);
+
+  if (comp_ptr && comp_ptr <= (worker->comp_buffer + length))
+  {
+    entry->packed_lengths[0] = (unsigned)(comp_ptr - worker->comp_buffer);
+    memcpy(entry->packed[0], worker->comp_buffer, entry->packed_lengths[0]);
+  }
+  else
+  {
+    entry->packed_lengths[0] = length + 1;
+  }
+}
+
+
+//
+// 'pcl_cache_hash()' - Compute a hash of a line and its dither phase.
+//
+// Four independent multiply/xor lanes are used so that the hash runs close to
+// memory bandwidth.
+//
+
+static uint64_t				// O - Hash value
+pcl_cache_hash(
+    const unsigned char *data,		// I - Data
+    size_t              length,		// I - Number of bytes
+    unsigned            phase)		// I - Dither phase
+{
+  uint64_t	h[4],			// Hash lanes
+		w[4];			// Words from data
+  unsigned	i;			// Looping var
+  const uint64_t prime = 0x100000001b3ULL;
+					// FNV-1a 64-bit prime
+
+
+  h[0] = 0xcbf29ce484222325ULL ^ phase;
+  h[1] = h[0] + 0x9e3779b97f4a7c15ULL;
+  h[2] = h[1] + 0x9e3779b97f4a7c15ULL;
+  h[3] = h[2] + 0x9e3779b97f4a7c15ULL;
+
+  for (; length >= sizeof(w); data += sizeof(w), length -= sizeof(w))
+  {
+    memcpy(w, data, sizeof(w));
+
+    for (i = 0; i < 4; i ++)
+    {
+      h[i] = (h[i] ^ w[i]) * prime;
+      h[i] ^= h[i] >> 29;
+    }
+  }
+
+  for (i = 0; length > 0; data ++, length --, i = (i + 1) & 3)
+    h[i] = (h[i] ^ *data) * prime;
+
+  return (h[0] ^ (h[1] << 1 | h[1] >> 63) ^ (h[2] << 2 | h[2] >> 62) ^ (h[3] << 3 | h[3] >> 61));
+}
+
+
+//
+// 'pcl_cache_line()' - Dither a line or find it in the worker's line cache.
+//
+// Forms, tables, and rules produce many identical lines, and the dithered and
+// PackBits-compressed result only depends on the printable area of the line
+// and the dither phase (`y & 15`).  Each worker keeps a small direct-mapped
+// cache of recent lines for the current page.  The delta row compression
+// modes depend on the previous line, so they are always redone.
+//
+
+static pcl_cache_t *			// O - Cached line
+pcl_cache_line(
+    pcl_t               *pcl,		// I - Job data
+    pcl_worker_t        *worker,	// I - Worker
+    unsigned            y,		// I - Line number
+    const unsigned char *pixels)	// I - Line
+{
+  pcl_cache_t		*entry;		// Cache entry
+  uint64_t		hash;		// Hash of line
+  unsigned		plane,		// Current plane
+			count,		// Number of compressed bytes
+			used = 1;	// Planes that may have content
+  const unsigned char	*start = pixels + pcl->xstart * pcl->bits_per_pixel / 8;
+					// Start of printable area
+  size_t		length = (pcl->xend * pcl->bits_per_pixel + 7) / 8 - pcl->xstart * pcl->bits_per_pixel / 8;
+					// Length of printable area
+
+
+  if (pcl->bits_per_pixel == 1)
+  {
+    // 1-bit lines aren't dithered, so don't bother caching them.  Use the
+    // line as-is when the left margin is byte-aligned and no pixels past the
+    // right margin are set, otherwise shift and copy the printable area...
+    entry        = worker->cache;
+    entry->valid = false;
+
+    if (!(pcl->xstart & 7) && (!(pcl->xend & 7) || !(start[pcl->linesize - 1] & (0xff >> (pcl->xend & 7)))))
+    {
+      entry->planes[0] = (unsigned char *)start;
+					// Only read from
+    }
+    else
+    {
+      entry->planes[0] = entry->pixels;
+      pcl_copy_1bit(pcl, entry->planes[0], pixels);
+    }
+  }
+  else
+  {
+    // Look for the line in the cache...
+    hash  = pcl_cache_hash(start, length, y & 15);
+    entry = worker->cache + (hash & (PCL_CACHE_SIZE - 1));
+
+    if (entry->valid && entry->hash == hash && entry->phase == (y & 15) && !memcmp(entry->pixels, start, length))
+    {
+      worker->cache_hits ++;
+      return (entry);
+    }
+
+    worker->cache_misses ++;
+
+    entry->valid = true;
+    entry->hash  = hash;
+    entry->phase = y & 15;
+
+    if (!pcl->dither_line)
+    {
+      // 8-bit black and gray lines are copied, dithered, and compressed in a
+      // single pass...
+      pcl_cache_8bit(pcl, worker, entry, y, pixels);
+      return (entry);
+    }
+
+    memcpy(entry->pixels, start, length);
+
+    used = (pcl->dither_line)(pcl, entry->planes, y, pixels);
+  }
+
+  // Trim trailing white space since the printer fills short lines with zeros,
+  // and try PackBits compression if enabled for the page - empty planes need
+  // neither...
+  for (plane = 0; plane < pcl->num_planes; plane ++)
+  {
+    if (!(used & (1 << plane)))
+    {
+      entry->lengths[plane]        = 0;
+      entry->packed_lengths[plane] = 0;
+      continue;
+    }
+
+    entry->lengths[plane] = pcl_line_length(entry->planes[plane], pcl->linesize);
+
+    if (!(pcl->page_modes & (1 << 2)))
+    {
+      entry->packed_lengths[plane] = entry->lengths[plane] + 1;
+      continue;
+    }
+
+    entry->packed_lengths[plane] = count = pcl_compress_packbits(worker->comp_buffer, entry->planes[plane], entry->lengths[plane]);
+
+    if (count <= entry->lengths[plane])
+      memcpy(entry->packed[plane], worker->comp_buffer, count);
+  }
+
+  return (entry);
+}
+
+
+//
+// 'pcl_callback()' - PCL callback.
+//
+
+static bool				// O - `true` on success, `false` on failure
+pcl_callback(
+    pappl_system_t         *system,	// I - System
+    const char             *driver_name,// I - Driver name
+    const char             *device_uri,	// I - Device URI (not used)
+    const char             *device_id,	// I - IEEE-1284 device ID
+    pappl_pr_driver_data_t *driver_data,// O - Driver data
+    ipp_t                  **driver_attrs,
+					// O - Driver attributes
+    void                   *data)	// I - Callback data (not used)
+{
+  int   i;				// Looping variable
+  static pappl_dither_t	dither =	// Blue-noise dither array
+  {
+    { 111,  49, 142, 162, 113, 195,  71, 177, 201,  50, 151,  94,  66,  37,  85, 252 },
+    {  25,  99, 239, 222,  32, 250, 148,  19,  38, 106, 220, 170, 194, 138,  13, 167 },
+    { 125, 178,  79,  15,  65, 173, 123,  87, 213, 131, 247,  23, 116,  54, 229, 212 },
+    {  41, 202, 152, 132, 189, 104,  53, 236, 161,  62,   1, 181,  77, 241, 147,  68 },
+    {   2, 244,  56,  91, 230,   5, 204,  28, 187, 101, 144, 206,  33,  92, 190, 107 },
+    { 223, 164, 114,  36, 214, 156, 139,  70, 245,  84, 226,  48, 126, 158,  17, 135 },
+    {  83, 196,  21, 254,  76,  45, 179, 115,  12,  40, 169, 105, 253, 176, 211,  59 },
+    { 100, 180, 145, 122, 172,  97, 235, 129, 215, 149, 199,   8,  72,  26, 238,  44 },
+    { 232,  31,  69,  11, 205,  58,  18, 193,  88,  60, 112, 221, 140,  86, 120, 153 },
+    { 208, 130, 243, 160, 224, 110,  34, 248, 165,  24, 234, 184,  52, 198, 171,   6 },
+    { 108, 188,  51,  89, 137, 186, 154,  78,  47, 134,  98, 157,  35, 249,  95,  63 },
+    {  16,  75, 219,  39,   0,  67, 228, 121, 197, 240,   3,  74, 127,  20, 227, 143 },
+    { 246, 175, 119, 200, 251, 103, 146,  14, 209, 174, 109, 218, 192,  82, 203, 163 },
+    {  29,  93, 150,  22, 166, 182,  55,  30,  90,  64,  42, 141, 168,  57, 117,  46 },
+    { 216, 233,  61, 128,  81, 237, 217, 118, 159, 255, 185,  27, 242, 102,   4, 133 },
+    {  73, 191,   9, 210,  43,  96,   7, 136, 231,  80,  10, 124, 225, 207, 155, 183 }
+  };
+
+
+  (void)data;
+  (void)device_uri;
+
+
+  // Set dither arrays with gamma correction...
+  pcl_gamma_dither(driver_data->gdither, dither);
+
+  // Same dither array for photo as well...
+  memcpy(driver_data->pdither, driver_data->gdither, sizeof(driver_data->pdither));
+
+  /* Set callbacks */
+  driver_data->printfile_cb  = pcl_print;
+  driver_data->rendjob_cb    = pcl_rendjob;
+  driver_data->rendpage_cb   = pcl_rendpage;
+  driver_data->rstartjob_cb  = pcl_rstartjob;
+  driver_data->rstartpage_cb = pcl_rstartpage;
+  driver_data->rwriteline_cb = pcl_rwriteline;
+  driver_data->status_cb     = pcl_status;
+  driver_data->has_supplies  = true;
+
+  /* Native format */
+  driver_data->format = "application/vnd.hp-pcl";
+
+  /* Number of band rendering threads, 0 for one per CPU */
+  driver_data->num_vendor = 1;
+  driver_data->vendor[0]  = "render-threads";
+
+  *driver_attrs = ippNew();
+  ippAddInteger(*driver_attrs, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "render-threads-default", 0);
+  ippAddRange(*driver_attrs, IPP_TAG_PRINTER, "render-threads-supported", 0, PCL_MAX_WORKERS);
+
+  /* Best raster compression supported by the printer, guessed from the device ID */
+  if (!strcmp(driver_name, "hp_deskjet") || !strcmp(driver_name, "hp_generic") || !strcmp(driver_name, "hp_laserjet"))
+  {
+    static const char * const deskjet_compression[] =
+    {					/* DeskJet compression values */
+      "packbits",
+      "delta-row",
+      "compressed-delta-row"
+    };
+    static const char * const laser_compression[] =
+    {					/* LaserJet/generic compression values */
+      "packbits",
+      "delta-row",
+      "adaptive"
+    };
+
+    driver_data->vendor[driver_data->num_vendor ++] = "pcl-compression";
+
+    ippAddString(*driver_attrs, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "pcl-compression-default", NULL, pcl_compression_default(driver_name, device_id));
+    ippAddStrings(*driver_attrs, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "pcl-compression-supported", 3, NULL, strcmp(driver_name, "hp_deskjet") ? laser_compression : deskjet_compression);
+
+    /* Tolerance for snapping nearly solid pixels, 0 for none */
+    driver_data->vendor[driver_data->num_vendor ++] = "pcl-snap-tolerance";
+
+    ippAddInteger(*driver_attrs, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "pcl-snap-tolerance-default", 0);
+    ippAddRange(*driver_attrs, IPP_TAG_PRINTER, "pcl-snap-tolerance-supported", 0, PCL_MAX_SNAP);
+  }
+
+  /* Halftone screen for LaserJet and generic PCL 5 printers */
+  if (!strcmp(driver_name, "hp_generic") || !strcmp(driver_name, "hp_laserjet"))
+  {
+    static const char * const halftones[] =
+    {					/* Halftone values */
+      "blue-noise",
+      "clustered-dot",
+      "line"
+    };
+
+    driver_data->vendor[driver_data->num_vendor ++] = "pcl-halftone";
+
+    ippAddString(*driver_attrs, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "pcl-halftone-default", NULL, "blue-noise");
+    ippAddStrings(*driver_attrs, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "pcl-halftone-supported", 3, NULL, halftones);
+  }
+
+  /* Default orientation and quality */
+  driver_data->orient_default  = IPP_ORIENT_NONE;
+  driver_data->quality_default = IPP_QUALITY_NORMAL;
+
+  if (!strcmp(driver_name, "hp_deskjet"))
+  {
+    /* Make and model name */
+    papplCopyString(driver_data->make_and_model, "HP DeskJet series", sizeof(driver_data->make_and_model));
+
+    /* Icons */
+    driver_data->icons[0].data    = hp_deskjet_sm_png;
+    driver_data->icons[0].datalen = sizeof(hp_deskjet_sm_png);
+
+    driver_data->icons[1].data    = hp_deskjet_md_png;
+    driver_data->icons[1].datalen = sizeof(hp_deskjet_md_png);
+
+    driver_data->icons[2].data    = hp_deskjet_lg_png;
+    driver_data->icons[2].datalen = sizeof(hp_deskjet_lg_png);
+
+    /* Pages-per-minute for monochrome and color */
+    driver_data->ppm       = 8;
+    driver_data->ppm_color = 2;
+
+    /* Three resolutions - 150dpi, 300dpi (default), and 600dpi */
+    driver_data->num_resolution  = 3;
+    driver_data->x_resolution[0] = 150;
+    driver_data->y_resolution[0] = 150;
+    driver_data->x_resolution[1] = 300;
+    driver_data->y_resolution[1] = 300;
+    driver_data->x_resolution[2] = 600;
+    driver_data->y_resolution[2] = 600;
+    driver_data->x_default = driver_data->y_default = 300;
+
+    /* Four color spaces - black (1-bit and 8-bit), grayscale, and sRGB */
+    driver_data->raster_types = PAPPL_PWG_RASTER_TYPE_BLACK_1 | PAPPL_PWG_RASTER_TYPE_BLACK_8 | PAPPL_PWG_RASTER_TYPE_SGRAY_8 | PAPPL_PWG_RASTER_TYPE_SRGB_8;
+
+    /* Color modes: auto (default), monochrome, and color */
+    driver_data->color_supported = PAPPL_COLOR_MODE_AUTO | PAPPL_COLOR_MODE_AUTO_MONOCHROME | PAPPL_COLOR_MODE_COLOR | PAPPL_COLOR_MODE_MONOCHROME;
+    driver_data->color_default   = PAPPL_COLOR_MODE_AUTO;
+
+    /* Media sizes with 1/4" left/right and 1/2" top/bottom margins*/
+    driver_data->num_media = (int)(sizeof(pcl_hp_deskjet_media) / sizeof(pcl_hp_deskjet_media[0]));
+    memcpy(driver_data->media, pcl_hp_deskjet_media, sizeof(pcl_hp_deskjet_media));
+
+    driver_data->left_right = 635;	 // 1/4" left and right
+    driver_data->bottom_top = 1270;	 // 1/2" top and bottom
+
+    /* 1-sided printing only */
+    driver_data->sides_supported = PAPPL_SIDES_ONE_SIDED;
+    driver_data->sides_default   = PAPPL_SIDES_ONE_SIDED;
+
+    /* Three paper trays (MSN names) */
+    driver_data->num_source = 3;
+    driver_data->source[0]  = "tray-1";
+    driver_data->source[1]  = "manual";
+    driver_data->source[2]  = "envelope";
+
+    /* Media types (MSN names) */
+    driver_data->num_type = 8;
+    driver_data->type[0]  = "stationery";
+    driver_data->type[1]  = "stationery-inkjet";
+    driver_data->type[2]  = "stationery-letterhead";
+    driver_data->type[3]  = "cardstock";
+    driver_data->type[4]  = "labels";
+    driver_data->type[5]  = "envelope";
+    driver_data->type[6]  = "transparency";
+    driver_data->type[7]  = "photographic";
+  }
+  else if (!strcmp(driver_name, "hp_generic"))
+  {
+    /* Make and model name */
+    papplCopyString(driver_data->make_and_model, "Generic PCL 5", sizeof(driver_data->make_and_model));
+
+    /* Icons */
+    driver_data->icons[0].data    = hp_generic_sm_png;
+    driver_data->icons[0].datalen = sizeof(hp_generic_sm_png);
+
+    driver_data->icons[1].data    = hp_generic_md_png;
+    driver_data->icons[1].datalen = sizeof(hp_generic_md_png);
+
+    driver_data->icons[2].data    = hp_generic_lg_png;
+    driver_data->icons[2].datalen = sizeof(hp_generic_lg_png);
+
+    /* Pages-per-minute for monochrome and color */
+    driver_data->ppm = 10;
+
+    /* Two resolutions - 300dpi (default) and 600dpi */
+    driver_data->num_resolution  = 2;
+    driver_data->x_resolution[0] = 300;
+    driver_data->y_resolution[0] = 300;
+    driver_data->x_resolution[1] = 600;
+    driver_data->y_resolution[1] = 600;
+    driver_data->x_default = driver_data->y_default = 300;
+
+    driver_data->raster_types = PAPPL_PWG_RASTER_TYPE_BLACK_1 | PAPPL_PWG_RASTER_TYPE_BLACK_8 | PAPPL_PWG_RASTER_TYPE_SGRAY_8;
+
+    driver_data->color_supported = PAPPL_COLOR_MODE_MONOCHROME;
+    driver_data->color_default   = PAPPL_COLOR_MODE_MONOCHROME;
+
+    driver_data->num_media = (int)(sizeof(pcl_generic_pcl_media) / sizeof(pcl_generic_pcl_media[0]));
+    memcpy(driver_data->media, pcl_generic_pcl_media, sizeof(pcl_generic_pcl_media));
+
+    driver_data->sides_supported = PAPPL_SIDES_ONE_SIDED | PAPPL_SIDES_TWO_SIDED_LONG_EDGE | PAPPL_SIDES_TWO_SIDED_SHORT_EDGE;
+    driver_data->sides_default   = PAPPL_SIDES_ONE_SIDED;
+
+    driver_data->num_source = 7;
+    driver_data->source[0]  = "default";
+    driver_data->source[1]  = "tray-1";
+    driver_data->source[2]  = "tray-2";
+    driver_data->source[3]  = "tray-3";
+    driver_data->source[4]  = "tray-4";
+    driver_data->source[5]  = "manual";
+    driver_data->source[6]  = "envelope";
+
+    /* Media types (MSN names) */
+    driver_data->num_type = 6;
+    driver_data->type[0]  = "stationery";
+    driver_data->type[1]  = "stationery-letterhead";
+    driver_data->type[2]  = "cardstock";
+    driver_data->type[3]  = "labels";
+    driver_data->type[4]  = "envelope";
+    driver_data->type[5]  = "transparency";
+
+    driver_data->left_right = 635;	// 1/4" left and right
+    driver_data->bottom_top = 423;	// 1/6" top and bottom
+
+    for (i = 0; i < driver_data->num_source; i ++)
+    {
+      if (strcmp(driver_data->source[i], "envelope"))
+        snprintf(driver_data->media_ready[i].size_name, sizeof(driver_data->media_ready[i].size_name), "na_letter_8.5x11in");
+      else
+        snprintf(driver_data->media_ready[i].size_name, sizeof(driver_data->media_ready[i].size_name), "env_10_4.125x9.5in");
+    }
+  }
+#if WITH_PCL6
+  else if (!strncmp(driver_name, "hp_generic6", 11))
+  {
+    // Native format...
+    driver_data->format = "application/vnd.hp-pclxl";
+
+    /* Make and model name */
+    if (driver_name[11] == 'c')
+      papplCopyString(driver_data->make_and_model, "Generic PCL 6 Color", sizeof(driver_data->make_and_model));
+    else
+      papplCopyString(driver_data->make_and_model, "Generic PCL 6 Monochrome", sizeof(driver_data->make_and_model));
+
+    /* Icons */
+    driver_data->icons[0].data    = hp_generic_sm_png;
+    driver_data->icons[0].datalen = sizeof(hp_generic_sm_png);
+
+    driver_data->icons[1].data    = hp_generic_md_png;
+    driver_data->icons[1].datalen = sizeof(hp_generic_md_png);
+
+    driver_data->icons[2].data    = hp_generic_lg_png;
+    driver_data->icons[2].datalen = sizeof(hp_generic_lg_png);
+
+    /* Pages-per-minute for monochrome and color */
+    driver_data->ppm = 10;
+
+    /* Two resolutions - 300dpi (default) and 600dpi */
+    driver_data->num_resolution  = 2;
+    driver_data->x_resolution[0] = 300;
+    driver_data->y_resolution[0] = 300;
+    driver_data->x_resolution[1] = 600;
+    driver_data->y_resolution[1] = 600;
+    driver_data->x_default = driver_data->y_default = 300;
+
+    if (driver_name[11] == 'c')
+    {
+      /* Four color spaces - black (1-bit and 8-bit), grayscale, and sRGB */
+      driver_data->raster_types = PAPPL_PWG_RASTER_TYPE_BLACK_1 | PAPPL_PWG_RASTER_TYPE_BLACK_8 | PAPPL_PWG_RASTER_TYPE_SGRAY_8 | PAPPL_PWG_RASTER_TYPE_SRGB_8;
+
+      /* Color modes: auto (default), monochrome, and color */
+      driver_data->color_supported = PAPPL_COLOR_MODE_AUTO | PAPPL_COLOR_MODE_AUTO_MONOCHROME | PAPPL_COLOR_MODE_COLOR | PAPPL_COLOR_MODE_MONOCHROME;
+      driver_data->color_default   = PAPPL_COLOR_MODE_AUTO;
+
+      driver_data->ppm_color = 10;
+    }
+    else
+    {
+      /* Three color spaces - black (1-bit and 8-bit) and grayscale */
+      driver_data->raster_types = PAPPL_PWG_RASTER_TYPE_BLACK_1 | PAPPL_PWG_RASTER_TYPE_BLACK_8 | PAPPL_PWG_RASTER_TYPE_SGRAY_8;
+
+      /* Color modes: monochrome */
+      driver_data->color_supported = PAPPL_COLOR_MODE_MONOCHROME;
+      driver_data->color_default   = PAPPL_COLOR_MODE_MONOCHROME;
+    }
+
+    driver_data->num_media = (int)(sizeof(pcl_generic_pcl_media) / sizeof(pcl_generic_pcl_media[0]));
+    memcpy(driver_data->media, pcl_generic_pcl_media, sizeof(pcl_generic_pcl_media));
+
+    driver_data->sides_supported = PAPPL_SIDES_ONE_SIDED | PAPPL_SIDES_TWO_SIDED_LONG_EDGE | PAPPL_SIDES_TWO_SIDED_SHORT_EDGE;
+    driver_data->sides_default   = PAPPL_SIDES_ONE_SIDED;
+
+    driver_data->num_source = 7;
+    driver_data->source[0]  = "default";
+    driver_data->source[1]  = "tray-1";
+    driver_data->source[2]  = "tray-2";
+    driver_data->source[3]  = "tray-3";
+    driver_data->source[4]  = "tray-4";
+    driver_data->source[5]  = "manual";
+    driver_data->source[6]  = "envelope";
+
+    /* Media types (MSN names) */
+    driver_data->num_type = 6;
+    driver_data->type[0]  = "stationery";
+    driver_data->type[1]  = "stationery-letterhead";
+    driver_data->type[2]  = "cardstock";
+    driver_data->type[3]  = "labels";
+    driver_data->type[4]  = "envelope";
+    driver_data->type[5]  = "transparency";
+
+    driver_data->left_right = 423;	// 1/6" left and right
+    driver_data->bottom_top = 423;	// 1/6" top and bottom
+
+    for (i = 0; i < driver_data->num_source; i ++)
+    {
+      if (strcmp(driver_data->source[i], "envelope"))
+        snprintf(driver_data->media_ready[i].size_name, sizeof(driver_data->media_ready[i].size_name), "na_letter_8.5x11in");
+      else
+        snprintf(driver_data->media_ready[i].size_name, sizeof(driver_data->media_ready[i].size_name), "env_10_4.125x9.5in");
+    }
+
+    // Number of lines per ReadImage block
+    driver_data->vendor[driver_data->num_vendor ++] = "pclxl-block-height";
+
+    ippAddInteger(*driver_attrs, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "pclxl-block-height-default", PCL6_BLOCK_HEIGHT);
+    ippAddRange(*driver_attrs, IPP_TAG_PRINTER, "pclxl-block-height-supported", 1, PCL6_MAX_BLOCK_HEIGHT);
+  }
+#endif // WITH_PCL6
+  else if (!strcmp(driver_name, "hp_laserjet"))
+  {
+    /* Make and model name */
+    papplCopyString(driver_data->make_and_model, "HP LaserJet series", sizeof(driver_data->make_and_model));
+
+    /* Icons */
+    driver_data->icons[0].data    = hp_laserjet_sm_png;
+    driver_data->icons[0].datalen = sizeof(hp_laserjet_sm_png);
+
+    driver_data->icons[1].data    = hp_laserjet_md_png;
+    driver_data->icons[1].datalen = sizeof(hp_laserjet_md_png);
+
+    driver_data->icons[2].data    = hp_laserjet_lg_png;
+    driver_data->icons[2].datalen = sizeof(hp_laserjet_lg_png);
+
+    /* Pages-per-minute for monochrome and color */
+    driver_data->ppm = 10;
+
+    /* Three resolutions - 150dpi, 300dpi (default), and 600dpi */
+    driver_data->num_resolution  = 3;
+    driver_data->x_resolution[0] = 150;
+    driver_data->y_resolution[0] = 150;
+    driver_data->x_resolution[1] = 300;
+    driver_data->y_resolution[1] = 300;
+    driver_data->x_resolution[2] = 600;
+    driver_data->y_resolution[2] = 600;
+    driver_data->x_default = driver_data->y_default = 300;
+
+    driver_data->raster_types = PAPPL_PWG_RASTER_TYPE_BLACK_1 | PAPPL_PWG_RASTER_TYPE_BLACK_8 | PAPPL_PWG_RASTER_TYPE_SGRAY_8;
+
+    driver_data->color_supported = PAPPL_COLOR_MODE_MONOCHROME;
+    driver_data->color_default   = PAPPL_COLOR_MODE_MONOCHROME;
+
+    driver_data->num_media = (int)(sizeof(pcl_hp_laserjet_media) / sizeof(pcl_hp_laserjet_media[0]));
+    memcpy(driver_data->media, pcl_hp_laserjet_media, sizeof(pcl_hp_laserjet_media));
+
+    driver_data->sides_supported = PAPPL_SIDES_ONE_SIDED | PAPPL_SIDES_TWO_SIDED_LONG_EDGE | PAPPL_SIDES_TWO_SIDED_SHORT_EDGE;
+    driver_data->sides_default   = PAPPL_SIDES_ONE_SIDED;
+
+    driver_data->num_source = 7;
+    driver_data->source[0]  = "default";
+    driver_data->source[1]  = "tray-1";
+    driver_data->source[2]  = "tray-2";
+    driver_data->source[3]  = "tray-3";
+    driver_data->source[4]  = "tray-4";
+    driver_data->source[5]  = "manual";
+    driver_data->source[6]  = "envelope";
+
+    /* Media types (MSN names) */
+    driver_data->num_type = 6;
+    driver_data->type[0]  = "stationery";
+    driver_data->type[1]  = "stationery-letterhead";
+    driver_data->type[2]  = "cardstock";
+    driver_data->type[3]  = "labels";
+    driver_data->type[4]  = "envelope";
+    driver_data->type[5]  = "transparency";
+
+    driver_data->left_right = 635;	// 1/4" left and right
+    driver_data->bottom_top = 423;	// 1/6" top and bottom
+
+    for (i = 0; i < driver_data->num_source; i ++)
+    {
+      if (strcmp(driver_data->source[i], "envelope"))
+        snprintf(driver_data->media_ready[i].size_name, sizeof(driver_data->media_ready[i].size_name), "na_letter_8.5x11in");
+      else
+        snprintf(driver_data->media_ready[i].size_name, sizeof(driver_data->media_ready[i].size_name), "env_10_4.125x9.5in");
+    }
+  }
+  else
+  {
+    papplLog(system, PAPPL_LOGLEVEL_ERROR, "Driver name '%s' not supported.", driver_name);
+    return (false);
+  }
+
+  // Fill out ready and default media (default == ready media from the first source)
+  for (i = 0; i < driver_data->num_source; i ++)
+  {
+    pwg_media_t *pwg;			/* Media size information */
+
+    /* Use US Letter for regular trays, #10 envelope for the envelope tray */
+    if (!strcmp(driver_data->source[i], "envelope"))
+      papplCopyString(driver_data->media_ready[i].size_name, "na_number-10_4.125x9.5in", sizeof(driver_data->media_ready[i].size_name));
+    else
+      papplCopyString(driver_data->media_ready[i].size_name, "na_letter_8.5x11in", sizeof(driver_data->media_ready[i].size_name));
+
+    /* Set margin and size information */
+    if ((pwg = pwgMediaForPWG(driver_data->media_ready[i].size_name)) != NULL)
+    {
+      driver_data->media_ready[i].bottom_margin = driver_data->bottom_top;
+      driver_data->media_ready[i].left_margin   = driver_data->left_right;
+      driver_data->media_ready[i].right_margin  = driver_data->left_right;
+      driver_data->media_ready[i].size_width    = pwg->width;
+      driver_data->media_ready[i].size_length   = pwg->length;
+      driver_data->media_ready[i].top_margin    = driver_data->bottom_top;
+      papplCopyString(driver_data->media_ready[i].source, driver_data->source[i], sizeof(driver_data->media_ready[i].source));
+      papplCopyString(driver_data->media_ready[i].type, driver_data->type[0],  sizeof(driver_data->media_ready[i].type));
+    }
+  }
+
+  driver_data->media_default = driver_data->media_ready[0];
+
+  return (true);
+}
+
+
+#ifdef PCL_X86
+//
+// 'pcl_compare_avx2()' - Count leading bytes that match the seed row using
+//                        AVX2.
+//
+
+PCL_AVX2
+static size_t				// O - Number of matching bytes found
+pcl_compare_avx2(
+    const unsigned char *line,		// I - Current line
+    const unsigned char *seed,		// I - Seed (previous) line
+    size_t              length)		// I - Number of bytes
+{
+  size_t	i;			// Current byte
+
+
+  // 32 bytes at a time, then let SSE2 do the rest...
+  for (i = 0; (i + 32) <= length; i += 32)
+  {
+    unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(line + i)), _mm256_loadu_si256((const __m256i *)(seed + i))));
+
+    if (mask != 0xffffffff)
+      return (i + (size_t)__builtin_ctz(~mask));
+  }
+
+  return (i + pcl_compare_sse2(line + i, seed + i, length - i));
+}
+#endif // PCL_X86
+
+
+#ifdef __ARM_NEON
+//
+// 'pcl_compare_neon()' - Count leading bytes that match the seed row using
+//                        NEON.
+//
+
+static size_t				// O - Number of matching bytes found
+pcl_compare_neon(
+    const unsigned char *line,		// I - Current line
+    const unsigned char *seed,		// I - Seed (previous) line
+    size_t              length)		// I - Number of bytes
+{
+  size_t	i;			// Current byte
+
+
+  // 16 bytes at a time...
+  for (i = 0; (i + 16) <= length; i += 16)
+  {
+    uint64x2_t v = vreinterpretq_u64_u8(veorq_u8(vld1q_u8(line + i), vld1q_u8(seed + i)));
+
+    if (vgetq_lane_u64(v, 0) | vgetq_lane_u64(v, 1))
+      break;
+  }
+
+  return (i);
+}
+#endif // __ARM_NEON
+
+
+#ifdef PCL_X86
+//
+// 'pcl_compare_sse2()' - Count leading bytes that match the seed row using
+//                        SSE2.
+//
+
+PCL_SSE2
+static size_t				// O - Number of matching bytes found
+pcl_compare_sse2(
+    const unsigned char *line,		// I - Current line
+    const unsigned char *seed,		// I - Seed (previous) line
+    size_t              length)		// I - Number of bytes
+{
+  size_t	i;			// Current byte
+
+
+  // 16 bytes at a time...
+  for (i = 0; (i + 16) <= length; i += 16)
+  {
+    unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(line + i)), _mm_loadu_si128((const __m128i *)(seed + i))));
+
+    if (mask != 0xffff)
+      return (i + (size_t)__builtin_ctz(~mask));
+  }
+
+  return (i);
+}
+#endif // PCL_X86
+
+
+//
+// 'pcl_compress_data()' - Compress a line of graphics.
+//
+// The smallest encoding supported by the printer is chosen, including the
+// cost of changing from the worker's current compression mode.  The length
+// may be shorter than the line when trailing zeros have been trimmed, but the
+// full line must still be readable for the delta row compression modes.
+//
+
+static int				// O - Compression mode
+pcl_compress_data(
+    pcl_t               *pcl,		// I - Job data
+    pcl_worker_t        *worker,	// I - Worker
+    const unsigned char *line,		// I - Data to compress
+    unsigned            length,		// I - Number of bytes
+    unsigned            plane,		// I - Color plane
+    const unsigned char *packed,	// I - PackBits-compressed data or `NULL` to compress
+    unsigned            packed_length,	// I - Number of PackBits-compressed bytes
+    const unsigned char **data,		// O - Compressed data
+    unsigned            *datalen)	// O - Number of compressed bytes
+{
+  const unsigned char	*line_ptr,	// Current byte pointer
+			*line_end;	// End-of-line byte pointer
+  unsigned		count;		// Count of bytes for output
+  int			comp;		// Current compression type
+
+
+  if (!length)
+  {
+    // Send an empty plane as a zero-length transfer without compressing -
+    // this clears the row in modes 0 and 2 but repeats the seed row in the
+    // delta row modes, so only stay in those when the seed row is empty...
+    if (worker->compression >= 0 && (worker->compression <= 2 || !worker->seed_length[plane]))
+      comp = worker->compression;
+    else
+      comp = 2;
+
+    if (pcl->page_modes & ((1 << 3) | (1 << 9)))
+    {
+      memset(worker->seed[plane], 0, worker->seed_length[plane]);
+      worker->seed_length[plane] = 0;
+    }
+
+    *data    = line;
+    *datalen = 0;
+
+    return (comp);
+  }
+
+  // Try doing TIFF PackBits compression...
+  if (!packed)
+  {
+    packed        = worker->comp_buffer;
+    packed_length = pcl_compress_packbits(worker->comp_buffer, line, length);
+  }
+
+  if (packed_length > length)
+  {
+    // Don't try compressing...
+    comp     = 0;
+    line_ptr = line;
+    line_end = line + length;
+  }
+  else
+  {
+    // Use PackBits compression...
+    comp     = 2;
+    line_ptr = packed;
+    line_end = packed + packed_length;
+  }
+
+  if (pcl->page_modes & ((1 << 3) | (1 << 9)))
+  {
+    // Try the delta row compression modes against the seed row, accounting
+    // for the 5 bytes needed to change the compression mode...
+    unsigned best = (unsigned)(line_end - line_ptr) + (comp != worker->compression ? 5 : 0);
+					// Size of best compression so far
+    unsigned char *trial;		// Buffer for trial compression
+    unsigned seed_length = worker->seed_length[plane];
+					// Length of seed row
+
+    // Only compare up to the end of the longer of the line and seed row...
+    if (seed_length < length)
+      seed_length = length;
+
+    if (pcl->page_modes & (1 << 3))
+    {
+      count = pcl_compress_mode3(worker->delta_buffer, line, worker->seed[plane], seed_length, best);
+
+      if ((count + (worker->compression != 3 ? 5 : 0)) < best)
+      {
+	// Use delta row compression...
+	comp     = 3;
+	line_ptr = worker->delta_buffer;
+	line_end = worker->delta_buffer + count;
+	best     = count + (worker->compression != 3 ? 5 : 0);
+      }
+    }
+
+    if (pcl->page_modes & (1 << 9))
+    {
+      // Use whichever buffer doesn't hold the best compression so far...
+      trial = line_ptr == worker->delta_buffer ? worker->comp_buffer : worker->delta_buffer;
+      count = pcl_compress_mode9(trial, line, worker->seed[plane], seed_length, best);
+
+      if ((count + (worker->compression != 9 ? 5 : 0)) < best)
+      {
+	// Use compressed replacement delta row compression...
+	comp     = 9;
+	line_ptr = trial;
+	line_end = trial + count;
+      }
+    }
+
+    // The printer's seed row is now the current line...
+    memcpy(worker->seed[plane], line, seed_length);
+    worker->seed_length[plane] = length;
+  }
+
+  *data    = line_ptr;
+  *datalen = (unsigned)(line_end - line_ptr);
+
+  return (comp);
+}
+
+
+//
+// 'pcl_compress_mode3()' - Compress a line using delta row compression.
+//
+// Each run of up to 8 bytes that differ from the seed row is written as a
+// command byte containing the run length and offset from the end of the
+// previous run, followed by the replacement bytes.  Compression stops as soon
+// as the output reaches `limit` bytes, in which case `limit` is returned.
+//
+
+static unsigned				// O - Number of bytes or `limit` if too large
+pcl_compress_mode3(
+    unsigned char       *dst,		// I - Output buffer
+    const unsigned char *line,		// I - Current line
+    const unsigned char *seed,		// I - Seed (previous) line
+    unsigned            length,		// I - Number of bytes
+    unsigned            limit)		// I - Maximum number of output bytes
+{
+  const unsigned char	*line_ptr,	// Current byte pointer
+			*line_end,	// End-of-line byte pointer
+			*start;		// Start of current run
+  unsigned char		*dst_ptr,	// Pointer into output buffer
+			*dst_end;	// End of output buffer
+  unsigned		offset,		// Offset from previous run
+			count;		// Number of replacement bytes
+
+
+  for (line_ptr = line, line_end = line + length, dst_ptr = dst, dst_end = dst + limit; line_ptr < line_end;)
+  {
+    // Skip bytes that match the seed row, using the vector unit for long
+    // runs...
+    start = line_ptr;
+
+    if (pcl_kernels->compare && (line_end - line_ptr) >= 32 && !memcmp(line_ptr, seed, 8))
+    {
+      size_t n = (pcl_kernels->compare)(line_ptr, seed, (size_t)(line_end - line_ptr));
+					// Number of matching bytes
+
+      line_ptr += n;
+      seed     += n;
+    }
+
+    for (; line_ptr < line_end && *line_ptr == *seed; line_ptr ++, seed ++);
+
+    if (line_ptr >= line_end)
+      break;
+
+    offset = (unsigned)(line_ptr - start);
+
+    // Collect up to 8 bytes that differ from the seed row...
+    for (start = line_ptr; line_ptr < line_end && *line_ptr != *seed && (line_ptr - start) < 8; line_ptr ++, seed ++);
+
+    count = (unsigned)(line_ptr - start);
+
+    if ((dst_ptr + 2 + offset / 255 + count) > dst_end)
+      return (limit);
+
+    // Write the command byte and any extra offset bytes...
+    if (offset < 31)
+    {
+      *dst_ptr++ = (unsigned char)(((count - 1) << 5) | offset);
+    }
+    else
+    {
+      *dst_ptr++ = (unsigned char)(((count - 1) << 5) | 31);
+
+      for (offset -= 31; offset >= 255; offset -= 255)
+        *dst_ptr++ = 255;
+
+      *dst_ptr++ = (unsigned char)offset;
+    }
+
+    // Then the replacement bytes...
+    memcpy(dst_ptr, start, count);
+    dst_ptr += count;
+  }
+
+  return ((unsigned)(dst_ptr - dst));
+}
+
+
+//
+// 'pcl_compress_mode9()' - Compress a line using compressed replacement delta
+//                          row compression.
+//
+// Bytes that differ from the seed row are written as a mix of literal runs
+// (command byte with a 4-bit offset and 3-bit count) and repeated runs
+// (command byte with a 2-bit offset and 5-bit count) - offsets and counts that
+// don't fit are continued in extra bytes, 255 meaning "more follows".
+// Compression stops as soon as the output reaches `limit` bytes, in which case
+// `limit` is returned.
+//
+
+static unsigned				// O - Number of bytes or `limit` if too large
+pcl_compress_mode9(
+    unsigned char       *dst,		// I - Output buffer
+    const unsigned char *line,		// I - Current line
+    const unsigned char *seed,		// I - Seed (previous) line
+    unsigned            length,		// I - Number of bytes
+    unsigned            limit)		// I - Maximum number of output bytes
+{
+  const unsigned char	*line_ptr,	// Current byte pointer
+			*line_end,	// End-of-line byte pointer
+			*start,		// Start of changed bytes
+			*run,		// Start of repeated bytes
+			*run_end;	// End of repeated bytes
+  unsigned char		*dst_ptr,	// Pointer into output buffer
+			*dst_end;	// End of output buffer
+  unsigned		offset,		// Offset from previous run
+			count;		// Number of bytes in run
+
+
+  for (line_ptr = line, line_end = line + length, dst_ptr = dst, dst_end = dst + limit; line_ptr < line_end;)
+  {
+    // Skip bytes that match the seed row, using the vector unit for long
+    // runs...
+    start = line_ptr;
+
+    if (pcl_kernels->compare && (line_end - line_ptr) >= 32 && !memcmp(line_ptr, seed, 8))
+    {
+      size_t n = (pcl_kernels->compare)(line_ptr, seed, (size_t)(line_end - line_ptr));
+					// Number of matching bytes
+
+      line_ptr += n;
+      seed     += n;
+    }
+
+    for (; line_ptr < line_end && *line_ptr == *seed; line_ptr ++, seed ++);
+
+    if (line_ptr >= line_end)
+      break;
+
+    offset = (unsigned)(line_ptr - start);
+
+    // Find the end of the bytes that differ from the seed row...
+    for (start = line_ptr; line_ptr < line_end && *line_ptr != *seed; line_ptr ++, seed ++);
+
+    while (start < line_ptr)
+    {
+      // Look for 4 or more repeated bytes, which are cheaper to encode as a
+      // repeated run than as part of a literal run...
+      for (run = start; (run + 3) < line_ptr && (run[0] != run[1] || run[0] != run[2] || run[0] != run[3]); run ++);
+
+      if ((run + 3) >= line_ptr)
+        run = line_ptr;
+
+      if (run > start)
+      {
+        // Literal run...
+        count = (unsigned)(run - start);
+
+	if ((dst_ptr + 3 + offset / 255 + count / 255 + count) > dst_end)
+	  return (limit);
+
+        *dst_ptr++ = (unsigned char)(((offset < 15 ? offset : 15) << 3) | (count < 8 ? count - 1 : 7));
+
+        if (offset >= 15)
+        {
+          for (offset -= 15; offset >= 255; offset -= 255)
+            *dst_ptr++ = 255;
+
+	  *dst_ptr++ = (unsigned char)offset;
+        }
+
+        if (count >= 8)
+        {
+          unsigned extra;		// Extra count
+
+          for (extra = count - 8; extra >= 255; extra -= 255)
+            *dst_ptr++ = 255;
+
+	  *dst_ptr++ = (unsigned char)extra;
+        }
+
+        memcpy(dst_ptr, start, count);
+        dst_ptr += count;
+        offset  = 0;
+      }
+
+      if (run < line_ptr)
+      {
+        // Repeated run...
+        for (run_end = run + 4; run_end < line_ptr && *run_end == *run; run_end ++);
+
+        count = (unsigned)(run_end - run);
+
+	if ((dst_ptr + 4 + offset / 255 + count / 255) > dst_end)
+	  return (limit);
+
+        *dst_ptr++ = (unsigned char)(0x80 | ((offset < 3 ? offset : 3) << 5) | (count < 33 ? count - 2 : 31));
+
+        if (offset >= 3)
+        {
+          for (offset -= 3; offset >= 255; offset -= 255)
+            *dst_ptr++ = 255;
+
+	  *dst_ptr++ = (unsigned char)offset;
+        }
+
+        if (count >= 33)
+        {
+          unsigned extra;		// Extra count
+
+          for (extra = count - 33; extra >= 255; extra -= 255)
+            *dst_ptr++ = 255;
+
+	  *dst_ptr++ = (unsigned char)extra;
+        }
+
+        *dst_ptr++ = *run;
+        offset     = 0;
+        run        = run_end;
+      }
+
+      start = run;
+    }
+  }
+
+  return ((unsigned)(dst_ptr - dst));
+}
+
+
+//
+// 'pcl_compress_packbits()' - Compress a line using TIFF PackBits compression.
+//
+// Run boundaries are found using `pcl_packbits_run()`.  Compression stops as
+// soon as the output is larger than the input, in which case `length + 1` is
+// returned and the caller should send the line uncompressed.  The output
+// buffer must hold at least `2 * length + 1` bytes.
+//
+
+static unsigned				// O - Number of output bytes or `length + 1` if larger than the input
+pcl_compress_packbits(
+    unsigned char       *dst,		// I - Output buffer
+    const unsigned char *line,		// I - Line
+    unsigned            length)		// I - Number of bytes
+{
+  unsigned char	*comp_ptr;		// End of compressed data
+
+
+  if ((comp_ptr = pcl_packbits_encode(dst, dst + length, &line, line + length, line + length)) == NULL)
+    return (length + 1);
+
+  return ((unsigned)(comp_ptr - dst));
+}
+
+
+//
+// 'pcl_compression_default()' - Guess the best compression for a printer.
+//
+// There is no way to ask a PCL printer which compression modes it supports,
+// and older printers fail on modes beyond PackBits, so PackBits is used unless
+// the COMMAND SET (CMD) key of the IEEE-1284 device ID shows otherwise: PCL 5e,
+// PCL 5c, and PCL XL printers support delta row compression, and HP DeskJet
+// printers that report PCL3GUI also support compressed replacement delta row
+// compression.  Adaptive compression must be enabled by the administrator.
+//
+
+static const char *			// O - "pcl-compression" value
+pcl_compression_default(
+    const char *driver_name,		// I - Driver name
+    const char *device_id)		// I - IEEE-1284 device ID, if any
+{
+  const char	*ret = "packbits";	// Return value
+  int		num_did;		// Number of device ID key/value pairs
+  cups_option_t	*did;			// Device ID key/value pairs
+  const char	*cmd;			// Command set value
+  size_t	len;			// Length of command set name
+
+
+  if (!device_id || !*device_id)
+    return (ret);
+
+  num_did = papplDeviceParseID(device_id, &did);
+
+  if ((cmd = cupsGetOption("COMMAND SET", num_did, did)) == NULL)
+    cmd = cupsGetOption("CMD", num_did, did);
+
+  while (cmd && *cmd)
+  {
+    // Look at each printer language in the list...
+    while (*cmd == ' ')
+      cmd ++;
+
+    len = strcspn(cmd, ",");
+
+    if (len == 7 && !strncasecmp(cmd, "PCL3GUI", 7) && !strcmp(driver_name, "hp_deskjet"))
+      ret = "compressed-delta-row";
+    else if (((len == 5 && (!strncasecmp(cmd, "PCL5E", 5) || !strncasecmp(cmd, "PCL5C", 5) || !strncasecmp(cmd, "PCLXL", 5))) || (len == 4 && !strncasecmp(cmd, "PCL6", 4))) && strcmp(ret, "compressed-delta-row"))
+      ret = "delta-row";
+
+    cmd += len;
+    if (*cmd == ',')
+      cmd ++;
+  }
+
+  cupsFreeOptions(num_did, did);
+
+  return (ret);
+}
+
+
+//
+// 'pcl_copy_1bit()' - Copy the printable area of a 1-bit line.
+//
+// When the left margin is not a multiple of 8 pixels, each output byte is
+// made from two adjacent source bytes.  Any pixels past the right margin are
+// cleared.
+//
+
+static void
+pcl_copy_1bit(
+    pcl_t               *pcl,		// I - Job data
+    unsigned char       *dst,		// I - Output bitmap
+    const unsigned char *pixels)	// I - Line
+{
+  const unsigned char	*src = pixels + pcl->xstart / 8;
+					// Start of printable area
+  unsigned		i = 0,		// Current byte
+			count = (unsigned)pcl->linesize,
+					// Number of output bytes
+			avail = (pcl->xend + 7) / 8 - pcl->xstart / 8,
+					// Number of source bytes
+			shift = pcl->xstart & 7;
+					// Left shift for each byte
+
+
+  if (!shift)
+  {
+    memcpy(dst, src, count);
+  }
+  else
+  {
+    // Whole vectors first, for bytes that have a following source byte...
+    if (pcl_kernels->copy_1bit && avail > 1)
+      i = (unsigned)(pcl_kernels->copy_1bit)(dst, src, count < avail ? count : avail - 1, shift);
+
+    // Then the remainder...
+    for (; i < count; i ++)
+      dst[i] = (unsigned char)((src[i] << shift) | ((i + 1) < avail ? src[i + 1] >> (8 - shift) : 0));
+  }
+
+  // Clear any pixels past the right margin...
+  if (pcl->width & 7)
+    dst[count - 1] &= (unsigned char)(0xff00 >> (pcl->width & 7));
+}
+
+
+#ifdef PCL_X86
+//
+// 'pcl_copy_1bit_avx2()' - Shift and copy 1-bit pixels using AVX2.
+//
+// `src[length]` must be readable.
+//
+
+PCL_AVX2
+static size_t				// O - Number of bytes copied
+pcl_copy_1bit_avx2(
+    unsigned char       *dst,		// I - Output bitmap
+    const unsigned char *src,		// I - Input pixels
+    size_t              length,		// I - Number of bytes
+    unsigned            shift)		// I - Left shift for each byte
+{
+  size_t	i;			// Current byte
+  const __m128i	lcount = _mm_cvtsi32_si128((int)shift),
+		rcount = _mm_cvtsi32_si128((int)(8 - shift));
+					// Shift counts
+  const __m256i	lmask = _mm256_set1_epi8((char)(0xff << shift)),
+		rmask = _mm256_set1_epi8((char)(0xff >> (8 - shift)));
+					// Masks for bits shifted between bytes
+
+
+  // 32 bytes at a time, then let SSE2 do the rest...
+  for (i = 0; (i + 32) <= length; i += 32)
+  {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(src + i));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(src + i + 1));
+
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_or_si256(_mm256_and_si256(_mm256_sll_epi16(a, lcount), lmask), _mm256_and_si256(_mm256_srl_epi16(b, rcount), rmask)));
+  }
+
+  return (i + pcl_copy_1bit_sse2(dst + i, src + i, length - i, shift));
+}
+#endif // PCL_X86
+
+
+#ifdef __ARM_NEON
+//
+// 'pcl_copy_1bit_neon()' - Shift and copy 1-bit pixels using NEON.
+//
+// `src[length]` must be readable.
+//
+
+static size_t				// O - Number of bytes copied
+pcl_copy_1bit_neon(
+    unsigned char       *dst,		// I - Output bitmap
+    const unsigned char *src,		// I - Input pixels
+    size_t              length,		// I - Number of bytes
+    unsigned            shift)		// I - Left shift for each byte
+{
+  size_t	i;			// Current byte
+  const int8x16_t lcount = vdupq_n_s8((int8_t)shift),
+		rcount = vdupq_n_s8((int8_t)shift - 8);
+					// Shift counts (negative shifts right)
+
+
+  // 16 bytes at a time...
+  for (i = 0; (i + 16) <= length; i += 16)
+    vst1q_u8(dst + i, vorrq_u8(vshlq_u8(vld1q_u8(src + i), lcount), vshlq_u8(vld1q_u8(src + i + 1), rcount)));
+
+  return (i);
+}
+#endif // __ARM_NEON
+
+
+#ifdef PCL_X86
+//
+// 'pcl_copy_1bit_sse2()' - Shift and copy 1-bit pixels using SSE2.
+//
+// `src[length]` must be readable.
+//
+
+PCL_SSE2
+static size_t				// O - Number of bytes copied
+pcl_copy_1bit_sse2(
+    unsigned char       *dst,		// I - Output bitmap
+    const unsigned char *src,		// I - Input pixels
+    size_t              length,		// I - Number of bytes
+    unsigned            shift)		// I - Left shift for each byte
+{
+  size_t	i;			// Current byte
+  const __m128i	lcount = _mm_cvtsi32_si128((int)shift),
+		rcount = _mm_cvtsi32_si128((int)(8 - shift)),
+					// Shift counts
+		lmask = _mm_set1_epi8((char)(0xff << shift)),
+		rmask = _mm_set1_epi8((char)(0xff >> (8 - shift)));
+					// Masks for bits shifted between bytes
+
+
+  // 16 bytes at a time...
+  for (i = 0; (i + 16) <= length; i += 16)
+  {
+    __m128i a = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i b = _mm_loadu_si128((const __m128i *)(src + i + 1));
+
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(_mm_and_si128(_mm_sll_epi16(a, lcount), lmask), _mm_and_si128(_mm_srl_epi16(b, rcount), rmask)));
+  }
+
+  return (i);
+}
+#endif // PCL_X86
+
+
+//
+// 'pcl_dither_8bit()' - Dither part of an 8-bit black or grayscale line.
+//
+// Runs of 64 or more identical pixels are filled from the flat patterns for
+// the dither row, everything else is thresholded one pixel at a time.  The
+// first column must be a multiple of 64 and the output bitmap must be
+// cleared.
+//
+
+static void
+pcl_dither_8bit(
+    pcl_t               *pcl,		// I - Job data
+    unsigned char       *dst,		// I - Output bitmap
+    unsigned            y,		// I - Line number
+    const unsigned char *pixels,	// I - Line
+    unsigned            first,		// I - First column
+    unsigned            count,		// I - Number of columns
+    bool                black)		// I - `true` for black, `false` for gray
+{
+  unsigned		x,		// Current column
+			start,		// Start of pixels to dither
+			end = first + count,
+					// End of pixels to dither
+			run;		// Number of pixels in flat run
+  unsigned char		pattern[2];	// Pattern for flat run
+  const unsigned char	*src = pixels + pcl->xstart,
+					// Printable area of line
+			*dither = pcl->dither[y & 15];
+					// Dither line
+
+
+  for (x = first, start = first; start < end;)
+  {
+    // Look for the next flat run...
+    for (run = 0; (x + 64) <= end; x += 64)
+    {
+      if ((run = pcl_flat_run(src + x, end - x, 1)) > 0)
+        break;
+    }
+
+    if (!run)
+      x = end;
+
+    // Dither up to the run and then fill it...
+    if (start < x)
+      pcl_dither_8bit_span(dst + start / 8, src + start, dither + start, x - start, black);
+
+    if (run)
+    {
+      pcl_flat_pattern(pcl, y, src[x], black, pattern);
+      pcl_flat_fill(dst + x / 8, pattern, run);
+      x += run;
+    }
+
+    start = x;
+  }
+}
+
+
+#ifdef PCL_X86
+//
+// 'pcl_dither_8bit_avx2()' - Dither 8-bit black or gray pixels using AVX2.
+//
+
+PCL_AVX2
+static unsigned				// O - Number of pixels dithered
+pcl_dither_8bit_avx2(
+    unsigned char       *dst,		// I - Output bitmap
+    const unsigned char *src,		// I - Input pixels
+    const unsigned char *dither,	// I - Tiled dither row
+    unsigned            count,		// I - Number of pixels
+    bool                black)		// I - `true` for black (K), `false` for gray (W)
+{
+  unsigned	x;			// Current column
+  const __m256i	rev = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+					// Byte reversal shuffle
+
+
+  // 32 pixels at a time: reverse the bytes in each group of 8 so that
+  // movemask produces MSB-first bits...
+  for (x = 0; (x + 32) <= count; x += 32)
+  {
+    __m256i p = _mm256_loadu_si256((const __m256i *)(src + x));
+    __m256i d = _mm256_loadu_si256((const __m256i *)(dither + x));
+
+    // p >= d is the same as max(p, d) == p...
+    unsigned bits = (unsigned)_mm256_movemask_epi8(_mm256_shuffle_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(p, d), p), rev));
+
+    if (!black)
+      bits = ~bits;
+
+    dst[0] = (unsigned char)bits;
+    dst[1] = (unsigned char)(bits >> 8);
+    dst[2] = (unsigned char)(bits >> 16);
+    dst[3] = (unsigned char)(bits >> 24);
+    dst += 4;
+  }
+
+  // Then let SSE2 do the rest...
+  return (x + pcl_dither_8bit_sse2(dst, src + x, dither + x, count - x, black));
+}
+#endif // PCL_X86
+
+
+#ifdef __ARM_NEON
+//
+// 'pcl_dither_8bit_neon()' - Dither 8-bit black or gray pixels using NEON.
+//
+
+static unsigned				// O - Number of pixels dithered
+pcl_dither_8bit_neon(
+    unsigned char       *dst,		// I - Output bitmap
+    const unsigned char *src,		// I - Input pixels
+    const unsigned char *dither,	// I - Tiled dither row
+    unsigned            count,		// I - Number of pixels
+    bool                black)		// I - `true` for black (K), `false` for gray (W)
+{
+  unsigned	x;			// Current column
+
+
+  // 16 pixels at a time...
+  for (x = 0; (x + 16) <= count; x += 16)
+  {
+    uint8x16_t p = vld1q_u8(src + x);
+    uint8x16_t d = vld1q_u8(dither + x);
+    unsigned bits = pcl_pack_neon(black ? vcgeq_u8(p, d) : vcltq_u8(p, d));
+
+    dst[0] = (unsigned char)bits;
+    dst[1] = (unsigned char)(bits >> 8);
+    dst += 2;
+  }
+
+  return (x);
+}
+#endif // __ARM_NEON
+
+
+//
+// 'pcl_dither_8bit_span()' - Dither 8-bit black or gray pixels.
+//
+
+static void
+pcl_dither_8bit_span(
+    unsigned char       *dst,		// I - Output bitmap (byte-aligned)
+    const unsigned char *src,		// I - Input pixels
+    const unsigned char *dither,	// I - Tiled dither row
+    unsigned            count,		// I - Number of pixels
+    bool                black)		// I - `true` for black, `false` for gray
+{
+  unsigned	x;			// Current column
+  unsigned char	bit,			// Current bit
+		byte;			// Byte in line
+
+
+  // Whole vectors first and then the remainder...
+  x = pcl_kernels->dither_8bit ? (pcl_kernels->dither_8bit)(dst, src, dither, count, black) : 0;
+
+  for (dst += x / 8, bit = 128, byte = 0; x < count; x ++)
+  {
+    if ((src[x] >= dither[x]) == black)
+      byte |= bit;
+
+    if (bit == 1)
+    {
+      *dst++ = byte;
+      byte   = 0;
+      bit    = 128;
+    }
+    else
+      bit /= 2;
+  }
+
+  if (bit < 128)
+    *dst = byte;
+}
+
+
+#ifdef PCL_X86
+//
+// 'pcl_dither_8bit_sse2()' - Dither 8-bit black or gray pixels using SSE2.
+//
+// The pixels are compared against a dither row that has been tiled to the
+// line width, and the comparison masks are packed directly into bytes with
+// the most significant bit first.  Only whole vectors are processed - the
+// number of pixels dithered (always a multiple of 8) is returned so that the
+// caller can dither any remaining pixels using the scalar code.
+//
+
+PCL_SSE2
+static unsigned				// O - Number of pixels dithered
+pcl_dither_8bit_sse2(
+    unsigned char       *dst,		// I - Output bitmap
+    const unsigned char *src,		// I - Input pixels
+    const unsigned char *dither,	// I - Tiled dither row
+    unsigned            count,		// I - Number of pixels
+    bool                black)		// I - `true` for black (K), `false` for gray (W)
+{
+  unsigned	x;			// Current column
+
+
+  // 16 pixels at a time...
+  for (x = 0; (x + 16) <= count; x += 16)
+  {
+    __m128i p = _mm_loadu_si128((const __m128i *)(src + x));
+    __m128i d = _mm_loadu_si128((const __m128i *)(dither + x));
+    unsigned bits = pcl_pack_sse2(_mm_cmpeq_epi8(_mm_max_epu8(p, d), p));
+
+    if (!black)
+      bits = ~bits;
+
+    dst[0] = (unsigned char)bits;
+    dst[1] = (unsigned char)(bits >> 8);
+    dst += 2;
+  }
+
+  return (x);
+}
+#endif // PCL_X86
+
+
+//
+// 'pcl_dither_line_rgb()' - Separate and dither an 8-bit sRGB line.
+//
+// Runs of 64 or more identical pixels are separated once using the flat
+// patterns for the dither row, everything else is separated and thresholded
+// one pixel at a time.
+//
+
+static unsigned				// O - Planes that may have content (bitmask)
+pcl_dither_line_rgb(
+    pcl_t               *pcl,		// I - Job data
+    unsigned char       *planes[4],	// I - Output bitmaps
+    unsigned            y,		// I - Line number
+    const unsigned char *pixels)	// I - Line
+{
+  unsigned		x,		// Current column
+			start,		// Start of pixels to dither
+			run,		// Number of pixels in flat run
+			plane,		// Current plane
+			used = 0;	// Planes used
+  unsigned char		*span[4],	// Output bitmaps for span
+			pattern[4][2],	// KCMY patterns for flat run
+			c[2],		// C pattern
+			m[2],		// M pattern
+			yy[2];		// Y pattern
+  const unsigned char	*src = pixels + 3 * pcl->xstart,
+					// Printable area of line
+			*dither = pcl->dither[y & 15];
+					// Dither line
+
+
+  memset(planes[0], 0, pcl->num_planes * pcl->linesize);
+
+  for (x = 0, start = 0; start < pcl->width;)
+  {
+    // Look for the next flat run...
+    for (run = 0; (x + 64) <= pcl->width; x += 64)
+    {
+      if ((run = pcl_flat_run(src + 3 * x, pcl->width - x, 3)) > 0)
+        break;
+    }
+
+    if (!run)
+      x = pcl->width;
+
+    // Dither up to the run...
+    if (start < x)
+    {
+      for (plane = 0; plane < 4; plane ++)
+        span[plane] = planes[plane] + start / 8;
+
+      used |= pcl_dither_rgb_span(span, src + 3 * start, dither + start, x - start);
+    }
+
+    if (run)
+    {
+      // Then separate the run's color and fill it - white runs are already
+      // zeroed...
+      pcl_flat_pattern(pcl, y, src[3 * x], false, c);
+      pcl_flat_pattern(pcl, y, src[3 * x + 1], false, m);
+      pcl_flat_pattern(pcl, y, src[3 * x + 2], false, yy);
+
+      pattern[0][0] = c[0] & m[0] & yy[0];
+      pattern[0][1] = c[1] & m[1] & yy[1];
+      pattern[1][0] = c[0] & ~pattern[0][0];
+      pattern[1][1] = c[1] & ~pattern[0][1];
+      pattern[2][0] = m[0] & ~pattern[0][0];
+      pattern[2][1] = m[1] & ~pattern[0][1];
+      pattern[3][0] = yy[0] & ~pattern[0][0];
+      pattern[3][1] = yy[1] & ~pattern[0][1];
+
+      for (plane = 0; plane < 4; plane ++)
+      {
+        if (pattern[plane][0] | pattern[plane][1])
+        {
+          pcl_flat_fill(planes[plane] + x / 8, pattern[plane], run);
+          used |= 1U << plane;
+        }
+      }
+
+      x += run;
+    }
+
+    start = x;
+  }
+
+  return (used);
+}
+
+
+#ifdef __ARM_NEON
+//
+// 'pcl_dither_rgb_neon()' - Separate and dither sRGB pixels using NEON.
+//
+
+static unsigned				// O - Number of pixels dithered
+pcl_dither_rgb_neon(
+    unsigned char       *planes[4],	// I - Output bitmaps (KCMY)
+    const unsigned char *src,		// I - Input pixels
+    const unsigned char *dither,	// I - Tiled dither row
+    unsigned            count,		// I - Number of pixels
+    unsigned            *used)		// O - Planes with content (bitmask)
+{
+  unsigned	x = 0,			// Current column
+		kused = 0,		// K bits set
+		cused = 0,		// C bits set
+		mused = 0,		// M bits set
+		yused = 0;		// Y bits set
+  unsigned char	*kptr = planes[0],	// Pointer into K plane
+		*cptr = planes[1],	// Pointer into C plane
+		*mptr = planes[2],	// Pointer into M plane
+		*yptr = planes[3];	// Pointer into Y plane
+
+
+  // 16 pixels at a time, NEON can deinterleave RGB as it loads...
+  for (; (x + 16) <= count; x += 16, src += 48)
+  {
+    uint8x16x3_t rgb = vld3q_u8(src);
+    uint8x16_t	d = vld1q_u8(dither + x),
+		c = vcltq_u8(rgb.val[0], d),
+		m = vcltq_u8(rgb.val[1], d),
+		y = vcltq_u8(rgb.val[2], d),
+		k = vandq_u8(vandq_u8(c, m), y);
+    unsigned	kbits = pcl_pack_neon(k),
+		cbits = pcl_pack_neon(vbicq_u8(c, k)),
+		mbits = pcl_pack_neon(vbicq_u8(m, k)),
+		ybits = pcl_pack_neon(vbicq_u8(y, k));
+
+    *kptr++ = (unsigned char)kbits;
+    *kptr++ = (unsigned char)(kbits >> 8);
+    *cptr++ = (unsigned char)cbits;
+    *cptr++ = (unsigned char)(cbits >> 8);
+    *mptr++ = (unsigned char)mbits;
+    *mptr++ = (unsigned char)(mbits >> 8);
+    *yptr++ = (unsigned char)ybits;
+    *yptr++ = (unsigned char)(ybits >> 8);
+
+    kused |= kbits;
+    cused |= cbits;
+    mused |= mbits;
+    yused |= ybits;
+  }
+
+  *used = (kused ? 1 : 0) | (cused ? 2 : 0) | (mused ? 4 : 0) | (yused ? 8 : 0);
+
+  return (x);
+}
+#endif // __ARM_NEON
+
+
+//
+// 'pcl_dither_rgb_span()' - Separate and dither sRGB pixels.
+//
+
+static unsigned				// O - Planes with content (bitmask)
+pcl_dither_rgb_span(
+    unsigned char       *planes[4],	// I - Output bitmaps (KCMY, byte-aligned)
+    const unsigned char *src,		// I - Input pixels
+    const unsigned char *dither,	// I - Tiled dither row
+    unsigned            count)		// I - Number of pixels
+{
+  unsigned		x,		// Current column
+			used = 0;	// Planes used by vector code
+  unsigned char		bit,		// Current bit
+			*cptr,		// Pointer into c-plane
+			*mptr,		// Pointer into m-plane
+			*yptr,		// Pointer into y-plane
+			*kptr,		// Pointer into k-plane
+			byte,		// Byte in line
+			kbits = 0,	// Bits used in k-plane remainder
+			cbits = 0,	// Bits used in c-plane remainder
+			mbits = 0,	// Bits used in m-plane remainder
+			ybits = 0;	// Bits used in y-plane remainder
+
+
+  // Whole vectors first and then the remainder...
+  x = pcl_kernels->dither_rgb ? (pcl_kernels->dither_rgb)(planes, src, dither, count, &used) : 0;
+
+  for (cptr = planes[1] + x / 8, mptr = planes[2] + x / 8, yptr = planes[3] + x / 8, kptr = planes[0] + x / 8, src += 3 * x, bit = 128; x < count; x ++)
+  {
+    if (*src ++ < dither[x])
+      *cptr |= bit;
+    if (*src ++ < dither[x])
+      *mptr |= bit;
+    if (*src ++ < dither[x])
+      *yptr |= bit;
+
+    if (bit == 1)
+    {
+      // Extract black from the common CMY bits...
+      *kptr   = *cptr & *mptr & *yptr;
+      byte    = ~*kptr;
+      *cptr  &= byte;
+      *mptr  &= byte;
+      *yptr  &= byte;
+
+      kbits |= *kptr++;
+      cbits |= *cptr++;
+      mbits |= *mptr++;
+      ybits |= *yptr++;
+      bit = 128;
+    }
+    else
+      bit /= 2;
+  }
+
+  // A partial byte at the end of the line keeps its composite CMY bits...
+  if (bit < 128)
+  {
+    cbits |= *cptr;
+    mbits |= *mptr;
+    ybits |= *yptr;
+  }
+
+  return (used | (kbits ? 1 : 0) | (cbits ? 2 : 0) | (mbits ? 4 : 0) | (ybits ? 8 : 0));
+}
+
+
+#ifdef PCL_X86
+//
+// 'pcl_dither_rgb_sse2()' - Separate and dither sRGB pixels using SSE2.
+//
+// The interleaved RGB pixels are split into R, G, and B vectors, compared
+// against the tiled dither row, and packed into the C, M, and Y planes.  Black
+// is extracted from the common CMY bits and removed from the color planes in
+// whole words, so all four plane buffers are written in a single pass.  As
+// with the other dither kernels, the number of pixels dithered is returned and
+// the caller dithers any remaining pixels using the scalar code.
+//
+
+PCL_SSE2
+static unsigned				// O - Number of pixels dithered
+pcl_dither_rgb_sse2(
+    unsigned char       *planes[4],	// I - Output bitmaps (KCMY)
+    const unsigned char *src,		// I - Input pixels
+    const unsigned char *dither,	// I - Tiled dither row
+    unsigned            count,		// I - Number of pixels
+    unsigned            *used)		// O - Planes with content (bitmask)
+{
+  unsigned	x = 0,			// Current column
+		kused = 0,		// K bits set
+		cused = 0,		// C bits set
+		mused = 0,		// M bits set
+		yused = 0;		// Y bits set
+  unsigned char	*kptr = planes[0],	// Pointer into K plane
+		*cptr = planes[1],	// Pointer into C plane
+		*mptr = planes[2],	// Pointer into M plane
+		*yptr = planes[3];	// Pointer into Y plane
+
+
+  // 32 pixels at a time...
+  for (; (x + 32) <= count; x += 32, src += 96)
+  {
+    __m128i	v0 = _mm_loadu_si128((const __m128i *)src),
+		v1 = _mm_loadu_si128((const __m128i *)(src + 16)),
+		v2 = _mm_loadu_si128((const __m128i *)(src + 32)),
+		v3 = _mm_loadu_si128((const __m128i *)(src + 48)),
+		v4 = _mm_loadu_si128((const __m128i *)(src + 64)),
+		v5 = _mm_loadu_si128((const __m128i *)(src + 80)),
+		t0, t1, t2, t3, t4, t5;
+    int		i;			// Looping var
+
+    // Deinterleave RGB using 5 rounds of byte unpacking, leaving R in v0/v1,
+    // G in v2/v3, and B in v4/v5...
+    for (i = 0; i < 5; i ++)
+    {
+      t0 = _mm_unpacklo_epi8(v0, v3);
+      t1 = _mm_unpackhi_epi8(v0, v3);
+      t2 = _mm_unpacklo_epi8(v1, v4);
+      t3 = _mm_unpackhi_epi8(v1, v4);
+      t4 = _mm_unpacklo_epi8(v2, v5);
+      t5 = _mm_unpackhi_epi8(v2, v5);
+
+      v0 = t0;
+      v1 = t1;
+      v2 = t2;
+      v3 = t3;
+      v4 = t4;
+      v5 = t5;
+    }
+
+    // Threshold each half - the comparisons give R/G/B >= dither, i.e. the
+    // inverse of the C/M/Y bits...
+    for (i = 0; i < 2; i ++)
+    {
+      __m128i	d = _mm_loadu_si128((const __m128i *)(dither + x + 16 * i)),
+		r = i ? v1 : v0,
+		g = i ? v3 : v2,
+		b = i ? v5 : v4;
+      unsigned	rbits = pcl_pack_sse2(_mm_cmpeq_epi8(_mm_max_epu8(r, d), r)),
+		gbits = pcl_pack_sse2(_mm_cmpeq_epi8(_mm_max_epu8(g, d), g)),
+		bbits = pcl_pack_sse2(_mm_cmpeq_epi8(_mm_max_epu8(b, d), b)),
+		kbits = ~(rbits | gbits | bbits),
+		cbits = ~rbits & ~kbits,
+		mbits = ~gbits & ~kbits,
+		ybits = ~bbits & ~kbits;
+
+      *kptr++ = (unsigned char)kbits;
+      *kptr++ = (unsigned char)(kbits >> 8);
+      *cptr++ = (unsigned char)cbits;
+      *cptr++ = (unsigned char)(cbits >> 8);
+      *mptr++ = (unsigned char)mbits;
+      *mptr++ = (unsigned char)(mbits >> 8);
+      *yptr++ = (unsigned char)ybits;
+      *yptr++ = (unsigned char)(ybits >> 8);
+
+      kused |= kbits & 0xffff;
+      cused |= cbits;
+      mused |= mbits;
+      yused |= ybits;
+    }
+  }
+
+  *used = (kused ? 1 : 0) | (cused ? 2 : 0) | (mused ? 4 : 0) | (yused ? 8 : 0);
+
+  return (x);
+}
+#endif // PCL_X86
+
+
+//
+// 'pcl_flat_fill()' - Fill a run of pixels with a flat pattern.
+//
+
+static void
+pcl_flat_fill(
+    unsigned char       *dst,		// I - Output bitmap (16-pixel aligned)
+    const unsigned char *pattern,	// I - 16-pixel pattern
+    unsigned            count)		// I - Number of pixels (multiple of 16)
+{
+  unsigned char	*end = dst + count / 8;	// End of run
+
+
+  if (pattern[0] == pattern[1])
+  {
+    memset(dst, pattern[0], count / 8);
+  }
+  else
+  {
+    while (dst < end)
+    {
+      *dst++ = pattern[0];
+      *dst++ = pattern[1];
     }
-    else if (line_ptr[0] == line_ptr[1])
+  }
+}
+
+
+//
+// 'pcl_flat_pattern()' - Get the 16-pixel pattern of a level for a flat run.
+//
+// The patterns are computed once per job from the halftone screen, so they
+// are rotated to line up with the left margin of the page.  Gray and color
+// pixels are set below the threshold, giving the inverse of the black
+// pattern.
+//
+
+static void
+pcl_flat_pattern(
+    pcl_t         *pcl,			// I - Job data
+    unsigned      y,			// I - Line number
+    unsigned      level,		// I - Pixel value
+    bool          black,		// I - `true` for black, `false` for gray/color
+    unsigned char pattern[2])		// O - 16-pixel pattern
+{
+  unsigned	bits = (unsigned)((pcl->flat[y & 15][2 * level] << 8) | pcl->flat[y & 15][2 * level + 1]);
+					// Pattern bits
+
+
+  if (pcl->flat_shift)
+    bits = (bits << pcl->flat_shift) | (bits >> (16 - pcl->flat_shift));
+
+  if (!black)
+    bits = ~bits;
+
+  pattern[0] = (unsigned char)(bits >> 8);
+  pattern[1] = (unsigned char)bits;
+}
+
+
+//
+// 'pcl_flat_run()' - Find a run of identical pixels.
+//
+// Runs must be at least 64 pixels long so that the checks are cheap compared
+// to dithering, and are a multiple of 16 pixels long so that they can be
+// filled with whole patterns.
+//
+
+static unsigned				// O - Number of pixels in run or 0 for none
+pcl_flat_run(
+    const unsigned char *src,		// I - Input pixels
+    unsigned            count,		// I - Number of pixels
+    unsigned            bpp)		// I - Bytes per pixel
+{
+  unsigned	run;			// Number of pixels in run
+
+
+  // Check the ends before comparing the whole run...
+  if (count < 64 || memcmp(src, src + 63 * bpp, bpp) || memcmp(src, src + bpp, 63 * bpp))
+    return (0);
+
+  for (run = 64; (run + 16) <= count && !memcmp(src, src + run * bpp, 16 * bpp); run += 16);
+
+  return (run);
+}
+
+
+//
+// 'pcl_free_page()' - Free the memory allocated for a page.
+//
+
+static void
+pcl_free_page(pcl_t *pcl)		// I - Job data
+{
+  unsigned	i;			// Looping var
+
+
+  if (pcl->workers)
+  {
+    for (i = 0; i < pcl->num_workers; i ++)
+      free(pcl->workers[i].comp_buffer);
+  }
+
+  free(pcl->workers);
+  free(pcl->snap_line);
+
+  pcl->workers   = NULL;
+  pcl->snap_line = NULL;
+
+#if WITH_PCL6
+  free(pcl->image_raw);
+  pcl->image_raw = NULL;
+#endif // WITH_PCL6
+}
+
+
+//
+// 'pcl_gamma_dither()' - Apply gamma correction to a dither array.
+//
+
+static void
+pcl_gamma_dither(
+    pappl_dither_t       dst,		// O - Corrected dither array
+    const pappl_dither_t src)		// I - Threshold array
+{
+  int	i, j;				// Looping vars
+
+
+  for (i = 0; i < 16; i ++)
+  {
+    for (j = 0; j < 16; j ++)
+      dst[i][j] = 255 - (int)(255.0 * pow(1.0 - src[i][j] / 255.0, 0.4545));
+  }
+}
+
+
+//
+// 'pcl_kernels_init()' - Choose the vector kernels for the current CPU.
+//
+// The best instruction set supported by the CPU is used by default.  The
+// "HP_PRINTER_APP_ISA" environment variable can force a lower level ("sse2",
+// "neon", or "none") for benchmarking and testing.  This runs before the
+// system exists, so unsupported values are saved and logged for each job.
+//
+
+static void
+pcl_kernels_init(void)
+{
+  const char	*isa = getenv("HP_PRINTER_APP_ISA");
+					// Forced instruction set, if any
+  const pcl_kernels_t *kernels,		// Current kernels
+		*best = NULL;		// Best supported kernels
+  static const pcl_kernels_t all_kernels[] =
+  {					// Kernels for each instruction set, best first
+#ifdef PCL_X86
+    { "avx2", pcl_blank_avx2, pcl_compare_avx2, pcl_copy_1bit_avx2, pcl_dither_8bit_avx2, pcl_dither_rgb_sse2, pcl_packbits_avx2, pcl_snap_avx2 },
+    { "sse2", pcl_blank_sse2, pcl_compare_sse2, pcl_copy_1bit_sse2, pcl_dither_8bit_sse2, pcl_dither_rgb_sse2, pcl_packbits_sse2, pcl_snap_sse2 },
+#elif defined(__ARM_NEON)
+    { "neon", pcl_blank_neon, pcl_compare_neon, pcl_copy_1bit_neon, pcl_dither_8bit_neon, pcl_dither_rgb_neon, pcl_packbits_neon, pcl_snap_neon },
+#endif // PCL_X86
+    { "none", NULL, NULL, NULL, NULL, NULL, NULL, NULL }
+  };
+
+
+#ifdef PCL_X86
+  __builtin_cpu_init();
+#endif // PCL_X86
+
+  for (kernels = all_kernels;; kernels ++)
+  {
+#ifdef PCL_X86
+    // Skip instruction sets the CPU doesn't support...
+    if (!strcmp(kernels->name, "avx2") && !__builtin_cpu_supports("avx2"))
+      continue;
+    else if (!strcmp(kernels->name, "sse2") && !__builtin_cpu_supports("sse2"))
+      continue;
+#endif // PCL_X86
+
+    if (!best)
+      best = kernels;
+
+    if (!isa || !strcmp(isa, kernels->name))
+      break;
+
+    if (!strcmp(kernels->name, "none"))
     {
-      // Repeated sequence...
-      line_ptr ++;
-      count = 2;
+      // The last entry is always "none"...
+      pcl_kernels_bad_isa = isa;
+      kernels             = best;
+      break;
+    }
+  }
+
+  pcl_kernels = kernels;
+}
+
+
+//
+// 'pcl_line_length()' - Return the length of a line without trailing zeros.
+//
+
+static unsigned				// O - Number of bytes up to the last non-zero byte
+pcl_line_length(
+    const unsigned char *line,		// I - Line
+    unsigned            length)		// I - Number of bytes
+{
+  uint64_t	word;			// Word from line
+
+
+  // Skip trailing zeros 8 bytes at a time...
+  while (length >= 8)
+  {
+    memcpy(&word, line + length - 8, sizeof(word));
+    if (word)
+      break;
+
+    length -= 8;
+  }
+
+  // Then find the last non-zero byte...
+  while (length > 0 && !line[length - 1])
+    length --;
+
+  return (length);
+}
+
+
+#ifdef __ARM_NEON
+//
+// 'pcl_pack_neon()' - Pack a NEON comparison mask into MSB-first bits.
+//
+
+static inline unsigned			// O - Packed bits (2 bytes, first byte in bits 0-7)
+pcl_pack_neon(uint8x16_t m)		// I - Comparison mask
+{
+  static const unsigned char weights[16] = { 128, 64, 32, 16, 8, 4, 2, 1, 128, 64, 32, 16, 8, 4, 2, 1 };
+					// Bit weights
+  uint8x8_t	t;			// Partial sums
+
+
+  // NEON has no movemask, so weight each lane by its bit value and then add
+  // the lanes in each half together...
+  m = vandq_u8(m, vld1q_u8(weights));
+  t = vpadd_u8(vget_low_u8(m), vget_high_u8(m));
+  t = vpadd_u8(t, t);
+  t = vpadd_u8(t, t);
+
+  return ((unsigned)vget_lane_u8(t, 0) | ((unsigned)vget_lane_u8(t, 1) << 8));
+}
+#endif // __ARM_NEON
+
+
+#ifdef PCL_X86
+//
+// 'pcl_pack_sse2()' - Pack a SSE2 comparison mask into MSB-first bits.
+//
+
+PCL_SSE2
+static inline unsigned			// O - Packed bits (2 bytes, first byte in bits 0-7)
+pcl_pack_sse2(__m128i m)		// I - Comparison mask
+{
+  // SSE2 has no byte shuffle, so reverse the words in each half and then swap
+  // the bytes in each word before extracting the sign bits...
+  m = _mm_shufflehi_epi16(_mm_shufflelo_epi16(m, 0x1b), 0x1b);
+  m = _mm_or_si128(_mm_slli_epi16(m, 8), _mm_srli_epi16(m, 8));
+
+  return ((unsigned)_mm_movemask_epi8(m));
+}
+#endif // PCL_X86
+
+
+#ifdef PCL_X86
+//
+// 'pcl_packbits_avx2()' - Count leading PackBits run positions using AVX2.
+//
+
+PCL_AVX2
+static size_t				// O - Number of positions found
+pcl_packbits_avx2(
+    const unsigned char *line,		// I - Line
+    size_t              count,		// I - Number of positions (`line[count]` must be readable)
+    bool                repeat)		// I - `true` for repeated bytes, `false` for literal bytes
+{
+  size_t	i;			// Current position
+  unsigned	flip = repeat ? 0 : 0xffffffff;
+					// Mask inversion for literal bytes
+
+
+  // 32 positions at a time, then let SSE2 do the rest...
+  for (i = 0; (i + 32) <= count; i += 32)
+  {
+    unsigned mask = flip ^ (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(line + i)), _mm256_loadu_si256((const __m256i *)(line + i + 1))));
+
+    if (mask != 0xffffffff)
+      return (i + (size_t)__builtin_ctz(~mask));
+  }
+
+  return (i + pcl_packbits_sse2(line + i, count - i, repeat));
+}
+#endif // PCL_X86
+
+
+//
+// 'pcl_packbits_encode()' - Encode PackBits runs.
+//
+// Runs starting before `stop` are encoded and `*line` is advanced past them.
+// Runs look ahead at most 128 bytes, so stopping 128 bytes before the end of
+// the data so far gives the same runs as encoding the whole line.  `NULL` is
+// returned once the output passes `comp_end`.
+//
+
+static unsigned char *			// O - End of output or `NULL` if too large
+pcl_packbits_encode(
+    unsigned char       *comp_ptr,	// I - Output buffer
+    unsigned char       *comp_end,	// I - End of output buffer
+    const unsigned char **line,		// IO - Line pointer
+    const unsigned char *line_end,	// I - End of line data
+    const unsigned char *stop)		// I - Stop before this byte
+{
+  const unsigned char	*line_ptr = *line;
+					// Current byte pointer
+  unsigned		count,		// Count of bytes for output
+			max;		// Maximum number of pairs to check
 
-      while (line_ptr < (line_end - 1) && line_ptr[0] == line_ptr[1] && count < 128)
-      {
-	line_ptr ++;
-	count ++;
-      }
 
-      *comp_ptr++ = (unsigned char)(257 - count);
+  while (line_ptr < stop)
+  {
+    if ((line_ptr + 1) >= line_end)
+    {
+      // Single byte on the end...
+      *comp_ptr++ = 0x00;
       *comp_ptr++ = *line_ptr++;
     }
     else
     {
-      // Non-repeated sequence...
-      start    = line_ptr;
-      line_ptr ++;
-      count    = 1;
+      if ((max = (unsigned)(line_end - line_ptr - 1)) > 128)
+        max = 128;
+
+      if (line_ptr[0] == line_ptr[1])
+      {
+	// Repeated sequence of up to 128 bytes...
+	count = 1 + pcl_packbits_run(line_ptr, max > 127 ? 127 : max, true);
 
-      while (line_ptr < (line_end - 1) && line_ptr[0] != line_ptr[1] && count < 128)
+	*comp_ptr++ = (unsigned char)(257 - count);
+	*comp_ptr++ = *line_ptr;
+	line_ptr += count;
+      }
+      else
       {
-	line_ptr ++;
-	count ++;
+	// Non-repeated sequence of up to 128 bytes...
+	count = pcl_packbits_run(line_ptr, max, false);
+
+	*comp_ptr++ = (unsigned char)(count - 1);
+
+	memcpy(comp_ptr, line_ptr, count);
+	comp_ptr += count;
+	line_ptr += count;
       }
+    }
+
+    if (comp_ptr > comp_end)
+      return (NULL);
+  }
+
+  *line = line_ptr;
+
+  return (comp_ptr);
+}
+
+
+#ifdef __ARM_NEON
+//
+// 'pcl_packbits_neon()' - Count leading PackBits run positions using NEON.
+//
+
+static size_t				// O - Number of positions found
+pcl_packbits_neon(
+    const unsigned char *line,		// I - Line
+    size_t              count,		// I - Number of positions (`line[count]` must be readable)
+    bool                repeat)		// I - `true` for repeated bytes, `false` for literal bytes
+{
+  size_t	i;			// Current position
+
+
+  // 16 positions at a time...
+  for (i = 0; (i + 16) <= count; i += 16)
+  {
+    uint8x16_t eq = vceqq_u8(vld1q_u8(line + i), vld1q_u8(line + i + 1));
+    uint64x2_t v = vreinterpretq_u64_u8(repeat ? vmvnq_u8(eq) : eq);
+
+    if (vgetq_lane_u64(v, 0) | vgetq_lane_u64(v, 1))
+      break;
+  }
+
+  return (i);
+}
+#endif // __ARM_NEON
+
+
+//
+// 'pcl_packbits_run()' - Count leading PackBits run positions.
+//
+// Position `i` is part of a repeated run when `line[i] == line[i + 1]` and
+// part of a literal run otherwise.  Most runs are short, so the first few
+// positions are checked directly before using the vector kernel.
+//
+
+static unsigned				// O - Number of positions found
+pcl_packbits_run(
+    const unsigned char *line,		// I - Line
+    unsigned            count,		// I - Number of positions (`line[count]` must be readable)
+    bool                repeat)		// I - `true` for repeated bytes, `false` for literal bytes
+{
+  unsigned	i;			// Current position
+
+
+  for (i = 0; i < count && i < 8 && (line[i] == line[i + 1]) == repeat; i ++);
+
+  if (i == 8 && pcl_kernels->packbits)
+    i += (unsigned)(pcl_kernels->packbits)(line + 8, count - 8, repeat);
+
+  for (; i < count && (line[i] == line[i + 1]) == repeat; i ++);
+
+  return (i);
+}
+
+
+#ifdef PCL_X86
+//
+// 'pcl_packbits_sse2()' - Count leading PackBits run positions using SSE2.
+//
+
+PCL_SSE2
+static size_t				// O - Number of positions found
+pcl_packbits_sse2(
+    const unsigned char *line,		// I - Line
+    size_t              count,		// I - Number of positions (`line[count]` must be readable)
+    bool                repeat)		// I - `true` for repeated bytes, `false` for literal bytes
+{
+  size_t	i;			// Current position
+  unsigned	flip = repeat ? 0 : 0xffff;
+					// Mask inversion for literal bytes
+
+
+  // 16 positions at a time...
+  for (i = 0; (i + 16) <= count; i += 16)
+  {
+    unsigned mask = flip ^ (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(line + i)), _mm_loadu_si128((const __m128i *)(line + i + 1))));
+
+    if (mask != 0xffff)
+      return (i + (size_t)__builtin_ctz(~mask));
+  }
+
+  return (i);
+}
+#endif // PCL_X86
+
+
+//
+// 'pcl_print()' - Print file.
+//
+
+static bool				// O - `true` on success, `false` on failure
+pcl_print(
+    pappl_job_t        *job,		// I - Job
+    pappl_pr_options_t *options,	// I - Options
+    pappl_device_t     *device)		// I - Device
+{
+  int		fd;			// Job file
+  ssize_t	bytes;			// Bytes read/written
+  char		buffer[65536];		// Read/write buffer
+
+
+  papplLogJob(job, PAPPL_LOGLEVEL_DEBUG, "Printing raw file...");
+
+  papplJobSetImpressions(job, 1);
+
+  fd = open(papplJobGetFilename(job), O_RDONLY);
+
+  while ((bytes = read(fd, buffer, sizeof(buffer))) > 0)
+  {
+    if (papplDeviceWrite(device, buffer, (size_t)bytes) < 0)
+    {
+      papplLogJob(job, PAPPL_LOGLEVEL_ERROR, "Unable to send %d bytes to printer.", (int)bytes);
+      close(fd);
+      return (false);
+    }
+  }
+
+  close(fd);
+
+  papplJobSetImpressionsCompleted(job, 1);
+
+  return (true);
+}
+
+
+//
+// 'pcl_ring_get()' - Get the next free band in the raster ring.
+//
+// The job thread blocks here when the workers and output thread are a full
+// ring behind.
+//
+
+static pcl_band_t *			// O - Band
+pcl_ring_get(pcl_t *pcl)		// I - Job data
+{
+  pcl_ring_t	*ring = &pcl->ring;	// Raster ring
+  unsigned	head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+					// Next band to fill
+  pcl_band_t	*band;			// Band
+
+
+  if ((head - atomic_load_explicit(&ring->tail, memory_order_acquire)) >= ring->num_bands)
+  {
+    // Ring is full, wait for the output thread...
+    pthread_mutex_lock(&ring->mutex);
+    atomic_fetch_add(&ring->waiting, 1);
+
+    while ((head - atomic_load(&ring->tail)) >= ring->num_bands)
+      pthread_cond_wait(&ring->cond, &ring->mutex);
+
+    atomic_fetch_sub(&ring->waiting, 1);
+    pthread_mutex_unlock(&ring->mutex);
+  }
+
+  band            = ring->bands + (head & (ring->num_bands - 1));
+  band->num_lines = 0;
+  band->has_prev  = false;
+  band->end       = false;
+
+  atomic_store_explicit(&band->done, false, memory_order_relaxed);
+
+  return (band);
+}
+
+
+//
+// 'pcl_ring_notify()' - Wake up any threads waiting on the raster ring.
+//
+
+static void
+pcl_ring_notify(pcl_ring_t *ring)	// I - Raster ring
+{
+  if (atomic_load(&ring->waiting))
+  {
+    pthread_mutex_lock(&ring->mutex);
+    pthread_cond_broadcast(&ring->cond);
+    pthread_mutex_unlock(&ring->mutex);
+  }
+}
+
+
+//
+// 'pcl_ring_put()' - Pass the band from `pcl_ring_get` to the workers.
+//
+
+static void
+pcl_ring_put(pcl_t *pcl)		// I - Job data
+{
+  atomic_fetch_add(&pcl->ring.head, 1);
+  pcl_ring_notify(&pcl->ring);
+}
+
+
+//
+// 'pcl_ring_start()' - Allocate the raster ring and start the worker and
+//                      output threads.
+//
+
+static bool				// O - `true` on success, `false` on failure
+pcl_ring_start(pcl_t          *pcl,	// I - Job data
+               pappl_device_t *device)	// I - Device
+{
+  pcl_ring_t	*ring = &pcl->ring;	// Raster ring
+  size_t	size;			// Size of each band
+  unsigned	i;			// Looping var
+
+
+  // Use two bands per worker so that workers don't wait on the output
+  // thread...
+  for (ring->num_bands = 4; ring->num_bands < 2 * pcl->num_workers; ring->num_bands *= 2);
+
+  // Each band holds the source lines (plus the line before) and the worst
+  // case PCL output for them...
+  size = (PCL_BAND_HEIGHT + 1) * pcl->bytes_per_line + PCL_BAND_HEIGHT * (pcl->num_planes * (pcl->linesize + 19) + 14);
+
+  if ((ring->bands = calloc(ring->num_bands, sizeof(pcl_band_t))) == NULL)
+    return (false);
+
+  if ((ring->buffer = malloc(ring->num_bands * size)) == NULL)
+  {
+    free(ring->bands);
+    ring->bands = NULL;
+    return (false);
+  }
+
+  for (i = 0; i < ring->num_bands; i ++)
+  {
+    ring->bands[i].pixels     = ring->buffer + i * size;
+    ring->bands[i].out_buffer = ring->bands[i].pixels + (PCL_BAND_HEIGHT + 1) * pcl->bytes_per_line;
+  }
+
+  atomic_init(&ring->head, 0);
+  atomic_init(&ring->next, 0);
+  atomic_init(&ring->tail, 0);
+  atomic_init(&ring->waiting, 0);
+  atomic_init(&ring->stop, false);
+  atomic_init(&pcl->out_error, false);
+
+  ring->device = device;
+
+  pthread_mutex_init(&ring->mutex, NULL);
+  pthread_cond_init(&ring->cond, NULL);
+
+  // Start the workers, making do with fewer if we run out of threads...
+  for (i = 0; i < pcl->num_workers; i ++)
+  {
+    if (pthread_create(&pcl->workers[i].thread, NULL, (void *(*)(void *))pcl_worker_thread, pcl->workers + i))
+      break;
+  }
+
+  if (i > 0 && !pthread_create(&ring->thread, NULL, (void *(*)(void *))pcl_ring_thread, pcl))
+  {
+    pcl->num_workers = i;
+    ring->running    = true;
+
+    return (true);
+  }
+
+  // Unable to start the threads, clean up...
+  atomic_store(&ring->stop, true);
+
+  pthread_mutex_lock(&ring->mutex);
+  pthread_cond_broadcast(&ring->cond);
+  pthread_mutex_unlock(&ring->mutex);
+
+  while (i > 0)
+    pthread_join(pcl->workers[-- i].thread, NULL);
+
+  pthread_cond_destroy(&ring->cond);
+  pthread_mutex_destroy(&ring->mutex);
+
+  free(ring->buffer);
+  free(ring->bands);
+  ring->buffer = NULL;
+  ring->bands  = NULL;
+
+  return (false);
+}
+
 
-      *comp_ptr++ = (unsigned char)(count - 1);
+//
+// 'pcl_ring_stop()' - Drain the raster ring and stop the worker and output
+//                     threads.
+//
 
-      memcpy(comp_ptr, start, count);
-      comp_ptr += count;
-    }
-  }
+static bool				// O - `true` on success, `false` on output error
+pcl_ring_stop(pcl_t *pcl)		// I - Job data
+{
+  pcl_ring_t	*ring = &pcl->ring;	// Raster ring
+  pcl_band_t	*band;			// End-of-page band
+  unsigned	i;			// Looping var
 
-  if ((unsigned)(comp_ptr - pcl->comp_buffer) > length)
-  {
-    // Don't try compressing...
-    comp = 0;
-  }
-  else
+
+  // Send the last partial band and the end-of-page marker...
+  if (pcl->band)
   {
-    // Use PackBits compression...
-    comp     = 2;
-    line_ptr = pcl->comp_buffer;
-    line_end = comp_ptr;
+    pcl_ring_put(pcl);
+    pcl->band = NULL;
   }
 
-  switch (pcl->driver)
-  {
-    case HP_DRIVER_DESKJET :
-    case HP_DRIVER_GENERIC :
-    case HP_DRIVER_LASERJET :
-	// Set compression mode as needed...
-	if (pcl->compression != comp)
-	{
-	  // Set compression
-	  pcl->compression = comp;
-	  papplDevicePrintf(device, "\033*b%uM", pcl->compression);
-	}
+  band      = pcl_ring_get(pcl);
+  band->end = true;
+  pcl_ring_put(pcl);
 
-	// Set the length of the data and write a raster plane...
-	papplDevicePrintf(device, "\033*b%d%c", (int)(line_end - line_ptr), plane < (pcl->num_planes - 1) ? 'V' : 'W');
-	papplDeviceWrite(device, line_ptr, (size_t)(line_end - line_ptr));
-	break;
+  // The output thread exits once everything has been sent...
+  pthread_join(ring->thread, NULL);
 
-#if WITH_PCL6
-    case HP_DRIVER_GENERIC6 :
-    case HP_DRIVER_GENERIC6C :
-        count = (unsigned)(line_end - line_ptr);
-        if (!comp)
-          count = (count + 3) & ~3;	// Pad to 32-bit boundary
-
-        pcl6_write_uint16(device, y - pcl->ystart, PCL6_ATTR_START_LINE);
-        pcl6_write_uint16(device, 1, PCL6_ATTR_BLOCK_HEIGHT);
-        pcl6_write_ubyte(device, comp ? PCL6_E_RLE_COMPRESSION : PCL6_E_NO_COMPRESSION, PCL6_ATTR_COMPRESS_MODE);
-//	pcl6_write_ubyte(device, 1, PCL6_ATTR_PAD_BYTES_MULTIPLE);
-//        pcl6_write_uint32(device, count, PCL6_ATTR_BLOCK_BYTE_LENGTH);
-        pcl6_write_command(device, PCL6_CMD_READ_IMAGE);
-        pcl6_write_data(device, line_ptr, count);
-        break;
-#endif // WITH_PCL6
-  }
+  // Then the workers are all idle and can be stopped...
+  atomic_store(&ring->stop, true);
+
+  pthread_mutex_lock(&ring->mutex);
+  pthread_cond_broadcast(&ring->cond);
+  pthread_mutex_unlock(&ring->mutex);
+
+  for (i = 0; i < pcl->num_workers; i ++)
+    pthread_join(pcl->workers[i].thread, NULL);
+
+  pthread_cond_destroy(&ring->cond);
+  pthread_mutex_destroy(&ring->mutex);
+
+  free(ring->buffer);
+  free(ring->bands);
+  ring->buffer  = NULL;
+  ring->bands   = NULL;
+  ring->running = false;
+
+  return (!pcl->out_error);
 }
 
 
 //
-// 'pcl_print()' - Print file.
+// 'pcl_ring_thread()' - Send encoded bands from the raster ring in page order.
 //
 
-static bool				// O - `true` on success, `false` on failure
-pcl_print(
-    pappl_job_t        *job,		// I - Job
-    pappl_pr_options_t *options,	// I - Options
-    pappl_device_t     *device)		// I - Device
+static void *				// O - Thread exit status (not used)
+pcl_ring_thread(pcl_t *pcl)		// I - Job data
 {
-  int		fd;			// Job file
-  ssize_t	bytes;			// Bytes read/written
-  char		buffer[65536];		// Read/write buffer
+  pcl_ring_t	*ring = &pcl->ring;	// Raster ring
+  pcl_band_t	*band;			// Current band
+  unsigned	tail;			// Next band to send
 
 
-  papplLogJob(job, PAPPL_LOGLEVEL_DEBUG, "Printing raw file...");
+  for (tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);; tail ++)
+  {
+    band = ring->bands + (tail & (ring->num_bands - 1));
 
-  papplJobSetImpressions(job, 1);
+    if (atomic_load(&ring->head) == tail || !atomic_load(&band->done))
+    {
+      // Band isn't ready, wait for the workers...
+      pthread_mutex_lock(&ring->mutex);
+      atomic_fetch_add(&ring->waiting, 1);
 
-  fd = open(papplJobGetFilename(job), O_RDONLY);
+      while (atomic_load(&ring->head) == tail || !atomic_load(&band->done))
+	pthread_cond_wait(&ring->cond, &ring->mutex);
 
-  while ((bytes = read(fd, buffer, sizeof(buffer))) > 0)
-  {
-    if (papplDeviceWrite(device, buffer, (size_t)bytes) < 0)
-    {
-      papplLogJob(job, PAPPL_LOGLEVEL_ERROR, "Unable to send %d bytes to printer.", (int)bytes);
-      close(fd);
-      return (false);
+      atomic_fetch_sub(&ring->waiting, 1);
+      pthread_mutex_unlock(&ring->mutex);
     }
-  }
 
-  close(fd);
+    if (band->end)
+      break;
 
-  papplJobSetImpressionsCompleted(job, 1);
+    pcl_write(pcl, ring->device, band->out_buffer, band->out_bytes);
 
-  return (true);
+    // Return the band to the job thread...
+    atomic_store(&ring->tail, tail + 1);
+    pcl_ring_notify(ring);
+  }
+
+  return (NULL);
 }
 
 
@@ -1040,6 +4041,12 @@ pcl_rendjob(
 
   (void)options;
 
+  // Finish any incomplete page...
+  if (pcl->ring.running)
+    pcl_ring_stop(pcl);
+
+  pcl_write_flush(pcl, device);
+
   switch (pcl->driver)
   {
     case HP_DRIVER_DESKJET :
@@ -1057,6 +4064,8 @@ pcl_rendjob(
 #endif // WITH_PCL6
   }
 
+  pcl_free_page(pcl);
+  free(pcl->dither_buffer);
   free(pcl);
   papplJobSetData(job, NULL);
 
@@ -1077,17 +4086,38 @@ pcl_rendpage(
     pappl_device_t     *device,		// I - Device
     unsigned           page)		// I - Page number
 {
-  pcl_t	*pcl = (pcl_t *)papplJobGetData(job);
+  pcl_t		*pcl = (pcl_t *)papplJobGetData(job);
 					// Job data
+  bool		ret;			// Return value
+  unsigned	i,			// Looping var
+		hits,			// Number of line cache hits
+		misses,			// Number of line cache misses
+		black;			// Number of color lines sent as black only
 
 
   papplLogJob(job, PAPPL_LOGLEVEL_DEBUG, "Ending page %u...", page);
 
+  // Wait for the worker and output threads and send any buffered raster
+  // data...
+  ret = true;
+
+  if (pcl->ring.running)
+    ret = pcl_ring_stop(pcl);
+
+  if (!pcl_write_flush(pcl, device))
+    ret = false;
+
   switch (pcl->driver)
   {
     case HP_DRIVER_DESKJET :
     case HP_DRIVER_GENERIC :
     case HP_DRIVER_LASERJET :
+        // Report the size and render time so halftones can be compared, then
+        // adjust the compression effort for the printer's link...
+        papplLogJob(job, PAPPL_LOGLEVEL_DEBUG, "Page %u: %llu bytes of raster data in %.1fms.", page, (unsigned long long)pcl->io_bytes, (pcl_time() - pcl->page_nsecs) / 1000000.0);
+
+        pcl_adjust_effort(job, pcl);
+
 	// Eject the current page...
 	if (pcl->num_planes > 1)
 	{
@@ -1109,6 +4139,8 @@ pcl_rendpage(
 #if WITH_PCL6
     case HP_DRIVER_GENERIC6 :
     case HP_DRIVER_GENERIC6C :
+        pcl6_write_image(pcl, device);
+
         pcl6_write_command(device, PCL6_CMD_END_IMAGE);
         pcl6_write_command(device, PCL6_CMD_CLOSE_DATA_SOURCE);
         pcl6_write_command(device, PCL6_CMD_END_PAGE);
@@ -1118,11 +4150,23 @@ pcl_rendpage(
 
   papplDeviceFlush(device);
 
-  // Free memory...
-  free(pcl->planes[0]);
-  free(pcl->comp_buffer);
+  // Log statistics and free memory...
+  for (i = 0, hits = 0, misses = 0, black = 0; i < pcl->num_workers; i ++)
+  {
+    hits   += pcl->workers[i].cache_hits;
+    misses += pcl->workers[i].cache_misses;
+    black  += pcl->workers[i].black_lines;
+  }
 
-  return (true);
+  if (hits || misses)
+    papplLogJob(job, PAPPL_LOGLEVEL_DEBUG, "Line cache: %u hits, %u misses.", hits, misses);
+
+  if (black)
+    papplLogJob(job, PAPPL_LOGLEVEL_DEBUG, "Sent %u color lines as black only.", black);
+
+  pcl_free_page(pcl);
+
+  return (ret);
 }
 
 
@@ -1137,17 +4181,42 @@ pcl_rstartjob(
     pappl_device_t     *device)		// I - Device
 {
   int		i;			// Looping var
+  unsigned	level,			// Pixel value
+		x;			// Looping var
   pcl_t		*pcl = (pcl_t *)calloc(1, sizeof(pcl_t));
 					// Job data
-  const char	*name = papplPrinterGetDriverName(papplJobGetPrinter(job));
+  const char	*name = papplPrinterGetDriverName(papplJobGetPrinter(job)),
 					// Driver name
+		*value;			// Vendor attribute value
+  long		num_workers = 0;	// Number of band workers
 
 
   papplLogJob(job, PAPPL_LOGLEVEL_DEBUG, "Starting job...");
 
+  if (pcl_kernels_bad_isa)
+    papplLogJob(job, PAPPL_LOGLEVEL_WARN, "Unsupported HP_PRINTER_APP_ISA value '%s', using '%s'.", pcl_kernels_bad_isa, pcl_kernels->name);
+
   pcl_update_status(papplJobGetPrinter(job), device);
 
-  (void)options;
+  // Get the number of band rendering threads, defaulting to one per CPU...
+  if ((value = cupsGetOption("render-threads", options->num_vendor, options->vendor)) != NULL)
+    num_workers = strtol(value, NULL, 10);
+
+  if (num_workers <= 0)
+    num_workers = sysconf(_SC_NPROCESSORS_ONLN);
+
+  if (num_workers < 1)
+    pcl->num_workers = 1;
+  else if (num_workers > PCL_MAX_WORKERS)
+    pcl->num_workers = PCL_MAX_WORKERS;
+  else
+    pcl->num_workers = (unsigned)num_workers;
+
+  papplLogJob(job, PAPPL_LOGLEVEL_DEBUG, "Using %u rendering threads.", pcl->num_workers);
+  papplLogJob(job, PAPPL_LOGLEVEL_DEBUG, "Using '%s' vector instructions.", pcl_kernels->name);
+
+  // Start with all of the printer's compression modes...
+  pcl->effort = PCL_MAX_EFFORT;
 
   // Save driver type...
   pcl->driver = HP_DRIVER_GENERIC;
@@ -1163,6 +4232,8 @@ pcl_rstartjob(
 
   papplJobSetData(job, pcl);
 
+  memcpy(pcl->screen, options->dither, sizeof(pcl->screen));
+
   switch (pcl->driver)
   {
     case HP_DRIVER_DESKJET :
@@ -1170,11 +4241,95 @@ pcl_rstartjob(
     case HP_DRIVER_GENERIC :
 	// Send a PCL reset sequence
 	papplDevicePuts(device, "\033E");
+
+        // All PCL 5 printers support TIFF PackBits compression, but other modes
+        // must be enabled for the printer...
+        pcl->comp_modes = (1 << 0) | (1 << 2);
+
+        if ((value = cupsGetOption("pcl-compression", options->num_vendor, options->vendor)) != NULL)
+        {
+	  for (i = 0; i < (int)(sizeof(pcl_compression) / sizeof(pcl_compression[0])); i ++)
+	  {
+	    if (!strcmp(value, pcl_compression[i].keyword))
+	    {
+	      pcl->comp_modes = (unsigned)pcl_compression[i].value;
+	      break;
+	    }
+	  }
+        }
+
+        papplLogJob(job, PAPPL_LOGLEVEL_DEBUG, "Using compression modes 0x%03x.", pcl->comp_modes);
+
+        // Get the tolerance for snapping nearly solid pixels, if any...
+        if ((value = cupsGetOption("pcl-snap-tolerance", options->num_vendor, options->vendor)) != NULL)
+        {
+          long tolerance = strtol(value, NULL, 10);
+					// Tolerance value
+
+          if (tolerance > 0)
+          {
+            pcl->snap_tolerance = tolerance > PCL_MAX_SNAP ? PCL_MAX_SNAP : (unsigned)tolerance;
+	    papplLogJob(job, PAPPL_LOGLEVEL_DEBUG, "Snapping pixels within %u of black or white.", pcl->snap_tolerance);
+          }
+        }
+
+        // Use the printer's halftone screen, if any, instead of the blue-noise
+        // dither array...
+        if ((value = cupsGetOption("pcl-halftone", options->num_vendor, options->vendor)) != NULL)
+        {
+	  for (i = 0; i < (int)(sizeof(pcl_screens) / sizeof(pcl_screens[0])); i ++)
+	  {
+	    if (!strcmp(value, pcl_screens[i].keyword))
+	    {
+	      pcl_gamma_dither(pcl->screen, pcl_screens[i].threshold);
+	      papplLogJob(job, PAPPL_LOGLEVEL_DEBUG, "Using '%s' halftone.", value);
+	      break;
+	    }
+	  }
+        }
+
+        // Precompute the packed 16-pixel black pattern of each level for flat
+        // regions - black pixels are set at or above the threshold...
+	for (i = 0; i < 16; i ++)
+	{
+	  for (level = 0; level < 256; level ++)
+	  {
+	    unsigned char *pattern = pcl->flat[i] + 2 * level;
+					// Pattern for level
+
+	    for (x = 0; x < 16; x ++)
+	    {
+	      if (level >= pcl->screen[i][x])
+	        pattern[x / 8] |= 128 >> (x & 7);
+	    }
+	  }
+	}
 	break;
 
 #if WITH_PCL6
     case HP_DRIVER_GENERIC6 :
     case HP_DRIVER_GENERIC6C :
+        // PCL XL supports RLE (PackBits) and delta row compression...
+        pcl->comp_modes = (1 << 0) | (1 << 2) | (1 << 3);
+
+        // Send consecutive lines in ReadImage blocks of up to N lines...
+        pcl->image_height = PCL6_BLOCK_HEIGHT;
+
+        if ((value = cupsGetOption("pclxl-block-height", options->num_vendor, options->vendor)) != NULL)
+        {
+          long height = strtol(value, NULL, 10);
+					// Block height value
+
+          if (height < 1)
+            pcl->image_height = 1;
+          else if (height > PCL6_MAX_BLOCK_HEIGHT)
+            pcl->image_height = PCL6_MAX_BLOCK_HEIGHT;
+          else
+            pcl->image_height = (unsigned)height;
+        }
+
+        papplLogJob(job, PAPPL_LOGLEVEL_DEBUG, "Using ReadImage blocks of up to %u lines.", pcl->image_height);
+
         // Send a PCL XL start sequence
         papplDevicePuts(device, "\033%-12345X@PJL ENTER LANGUAGE = PCLXL\r\n");
 
@@ -1205,8 +4360,14 @@ pcl_rstartpage(
     pappl_device_t     *device,		// I - Device
     unsigned           page)		// I - Page number
 {
-  size_t	i;			// Looping var
-  unsigned	plane;			// Looping var
+  size_t	i,			// Looping var
+		j,			// Looping var
+		pixels_size,		// Size of printable area of a line
+		num_entries;		// Number of line cache entries
+  unsigned	plane,			// Looping var
+		x,			// Looping var
+		dwidth;			// Width of tiled dither rows
+  unsigned char	*ptr;			// Pointer into worker buffer
   cups_page_header_t *header = &(options->header);
 					// Page header
   pcl_t		*pcl = (pcl_t *)papplJobGetData(job);
@@ -1318,6 +4479,8 @@ pcl_rstartpage(
 
   papplLogJob(job, PAPPL_LOGLEVEL_DEBUG, "Starting page %u...", page);
 
+  pcl->page_nsecs = pcl_time();
+
   // Setup size based on margins...
   pcl->width  = options->printer_resolution[0] * (options->media.size_width - options->media.left_margin - options->media.right_margin) / 2540;
   pcl->height = options->printer_resolution[1] * (options->media.size_length - options->media.top_margin - options->media.bottom_margin) / 2540;
@@ -1450,17 +4613,41 @@ pcl_rstartpage(
         // Start graphics
 	papplDevicePuts(device, "\033*r1A");
 
-        // Allocate dithering plane buffers
+        // Size of dithered lines...
 	pcl->linesize = (pcl->width + 7) / 8;
 
-	if ((pcl->planes[0] = malloc(pcl->linesize * pcl->num_planes)) == NULL)
-	{
-	  papplLogJob(job, PAPPL_LOGLEVEL_ERROR, "Memory allocation failure.");
-	  return (false);
-	}
+        // Tile the dither rows to the (padded) line width so the dithering
+        // kernels can load thresholds without wrapping - the rows are only
+        // rebuilt when a page is wider than the previous ones, and start at
+        // the left margin's offset into the screen...
+        dwidth = ((pcl->width + 63) & ~63U) + 16;
+
+        if (dwidth > pcl->dither_width)
+        {
+	  free(pcl->dither_buffer);
 
-	for (plane = 1; plane < pcl->num_planes; plane ++)
-	  pcl->planes[plane] = pcl->planes[0] + plane * pcl->linesize;
+	  if ((pcl->dither_buffer = malloc(16 * dwidth)) == NULL)
+	  {
+	    pcl->dither_width = 0;
+
+	    papplLogJob(job, PAPPL_LOGLEVEL_ERROR, "Memory allocation failure.");
+	    return (false);
+	  }
+
+	  pcl->dither_width = dwidth;
+
+	  for (i = 0; i < 16; i ++)
+	  {
+	    for (x = 0; x < dwidth; x ++)
+	      pcl->dither_buffer[i * dwidth + x] = pcl->screen[i][x & 15];
+	  }
+        }
+
+	for (i = 0; i < 16; i ++)
+	  pcl->dither[i] = pcl->dither_buffer + i * pcl->dither_width + (pcl->xstart & 15);
+
+        // The flat patterns are rotated by the same offset...
+        pcl->flat_shift = pcl->xstart & 15;
 	break;
 
 #if WITH_PCL6
@@ -1544,180 +4731,345 @@ pcl_rstartpage(
 	else
 	  pcl->linesize = pcl->width * header->cupsBitsPerPixel / 8;
 
-        pcl->linesize = (pcl->linesize + 3) & ~3;
-        break;
-#endif // WITH_PCL6
-  }
+        pcl->linesize = (pcl->linesize + 3) & ~3;
+        break;
+#endif // WITH_PCL6
+  }
+
+  // No blank lines or bands yet...
+  pcl->feed           = 0;
+  pcl->band           = NULL;
+  pcl->prev_pixels    = NULL;
+  pcl->bytes_per_line = header->cupsBytesPerLine;
+  pcl->bits_per_pixel = header->cupsBitsPerPixel;
+  pcl->color_space    = header->cupsColorSpace;
+
+  // Choose the ditherer for the page - 1-bit lines are copied as-is and 8-bit
+  // black and gray lines use pcl_cache_8bit()...
+  if (pcl->num_planes > 1)
+    pcl->dither_line = pcl_dither_line_rgb;
+  else
+    pcl->dither_line = NULL;
+
+  // Choose the compression modes for the page - less effort skips the delta
+  // row modes and then PackBits compression...
+  pcl->page_modes = pcl->comp_modes;
+
+  if (pcl->effort < PCL_MAX_EFFORT)
+    pcl->page_modes &= (1 << 0) | (1 << 2) | (1 << 5);
+  if (pcl->effort < 1)
+    pcl->page_modes &= (1 << 0) | (1 << 5);
+
+  pcl->io_nsecs = 0;
+  pcl->io_bytes = 0;
+
+  // Choose the band encoder for the page - adaptive compression falls back to
+  // the other modes for color pages...
+  if ((pcl->page_modes & (1 << 5)) && pcl->num_planes == 1 && (pcl->linesize + 3) <= PCL_BLOCK_SIZE)
+    pcl->encode_band = pcl_band_encode_adaptive;
+  else
+    pcl->encode_band = pcl_band_encode;
+
+  // Allocate memory for dithering and compression - PCL XL lines are
+  // compressed as they come in with a single worker and are not dithered,
+  // while 1-bit lines are not cached and only use the first line cache entry
+  // as a buffer...
+  pixels_size = (pcl->xend * pcl->bits_per_pixel + 7) / 8 - pcl->xstart * pcl->bits_per_pixel / 8;
+
+  if (pcl->bits_per_pixel == 1)
+  {
+    pixels_size = pcl->linesize;
+    num_entries = 1;
+  }
+  else
+    num_entries = PCL_CACHE_SIZE;
+
+#if WITH_PCL6
+  if (pcl->driver == HP_DRIVER_GENERIC6 || pcl->driver == HP_DRIVER_GENERIC6C)
+  {
+    pcl->num_workers = 1;
+    num_entries      = 0;
+  }
+#endif // WITH_PCL6
+
+  if ((pcl->workers = calloc(pcl->num_workers, sizeof(pcl_worker_t))) == NULL)
+  {
+    papplLogJob(job, PAPPL_LOGLEVEL_ERROR, "Memory allocation failure.");
+    return (false);
+  }
+
+  for (i = 0; i < pcl->num_workers; i ++)
+  {
+    pcl_worker_t *worker = pcl->workers + i;
+					// Worker
+
+    if ((worker->comp_buffer = malloc(2 * (pcl->linesize * 2 + 2) + pcl->num_planes * pcl->linesize + num_entries * (pixels_size + 2 * pcl->num_planes * pcl->linesize) + (pcl->encode_band == pcl_band_encode_adaptive ? PCL_BLOCK_SIZE : 0))) == NULL)
+    {
+      papplLogJob(job, PAPPL_LOGLEVEL_ERROR, "Memory allocation failure.");
+      return (false);
+    }
+
+    worker->pcl          = pcl;
+    worker->delta_buffer = worker->comp_buffer + pcl->linesize * 2 + 2;
+    worker->seed[0]      = worker->delta_buffer + pcl->linesize * 2 + 2;
+
+    for (plane = 1; plane < pcl->num_planes; plane ++)
+      worker->seed[plane] = worker->seed[0] + plane * pcl->linesize;
+
+    for (j = 0, ptr = worker->seed[0] + pcl->num_planes * pcl->linesize; j < num_entries; j ++)
+    {
+      pcl_cache_t *entry = worker->cache + j;
+					// Cache entry
+
+      entry->pixels = ptr;
+      ptr += pixels_size;
+
+      for (plane = 0; plane < pcl->num_planes; plane ++, ptr += pcl->linesize)
+        entry->planes[plane] = ptr;
+
+      for (plane = 0; plane < pcl->num_planes; plane ++, ptr += pcl->linesize)
+        entry->packed[plane] = ptr;
+    }
+
+    if (pcl->encode_band == pcl_band_encode_adaptive)
+      worker->block = ptr;
+  }
+
+  switch (pcl->driver)
+  {
+    case HP_DRIVER_DESKJET :
+    case HP_DRIVER_GENERIC :
+    case HP_DRIVER_LASERJET :
+        // Dither, compress, and send raster data in other threads...
+        pcl->write_line = pcl_writeline_pcl5;
+
+        // Snap 8-bit lines into a separate buffer since PAPPL owns the
+        // source lines...
+        if (pcl->snap_tolerance && pcl->bits_per_pixel > 1 && (pcl->snap_line = calloc(1, pcl->bytes_per_line)) == NULL)
+        {
+	  papplLogJob(job, PAPPL_LOGLEVEL_ERROR, "Memory allocation failure.");
+	  return (false);
+        }
+
+        if (!pcl_ring_start(pcl, device))
+        {
+	  papplLogJob(job, PAPPL_LOGLEVEL_ERROR, "Unable to start raster threads.");
+	  return (false);
+        }
+        break;
+
+#if WITH_PCL6
+    case HP_DRIVER_GENERIC6 :
+    case HP_DRIVER_GENERIC6C :
+        {
+          size_t rle_size = pcl->linesize + (pcl->linesize + 127) / 128,
+					// Maximum RLE-compressed line size
+		 delta_size = 2 + pcl->linesize + (pcl->linesize + 7) / 8 + 1;
+					// Maximum delta row-compressed line size
+
+	  // Compress raster data as it comes in and send it in blocks - delta
+	  // row lines start with a 16-bit byte count, so very wide lines are
+	  // only sent uncompressed or RLE-compressed...
+	  pcl->write_line   = pcl_writeline_pcl6;
+	  pcl->image_lines  = 0;
+	  pcl->image_seeded = true;
+
+	  if (!(pcl->comp_modes & (1 << 3)) || delta_size > 65537)
+	    delta_size = 0;
+
+	  if ((pcl->image_raw = malloc(pcl->image_height * (pcl->linesize + rle_size + delta_size) + pcl->linesize)) == NULL)
+	  {
+	    papplLogJob(job, PAPPL_LOGLEVEL_ERROR, "Memory allocation failure.");
+	    return (false);
+	  }
+
+	  pcl->image_rle   = pcl->image_raw + pcl->image_height * pcl->linesize;
+	  pcl->image_seed  = pcl->image_rle + pcl->image_height * rle_size;
+	  pcl->image_delta = delta_size ? pcl->image_seed + pcl->linesize : NULL;
+
+	  // The seed row starts out as all zeros for each image...
+	  memset(pcl->image_seed, 0, pcl->linesize);
+	}
+        break;
+#endif // WITH_PCL6
+  }
+
+  return (true);
+}
+
+
+//
+// 'pcl_rwriteline()' - Write a line.
+//
+
+static bool				// O - `true` on success, `false` on failure
+pcl_rwriteline(
+    pappl_job_t         *job,		// I - Job
+    pappl_pr_options_t  *options,	// I - Job options
+    pappl_device_t      *device,	// I - Device
+    unsigned            y,		// I - Line number
+    const unsigned char *pixels)	// I - Line
+{
+  pcl_t			*pcl = (pcl_t *)papplJobGetData(job);
+					// Job data
+
+
+  // Skip top and bottom margin areas...
+  if (y < pcl->ystart || y >= pcl->yend)
+    return (true);
+
+  if (!(y & 127))
+    papplLogJob(job, PAPPL_LOGLEVEL_DEBUG, "Printing line %u (%u%%)", y, 100 * (y - pcl->ystart) / pcl->height);
+
+  // Snap nearly solid pixels to black or white so they dither to long runs...
+  if (pcl->snap_line)
+    pixels = pcl_snap_line(pcl, pixels);
+
+  // Write the line using the writer for the page...
+  return ((pcl->write_line)(pcl, device, y, pixels));
+}
+
+
+#ifdef PCL_X86
+//
+// 'pcl_snap_avx2()' - Snap nearly solid bytes to 0 or 255 using AVX2.
+//
+
+PCL_AVX2
+static size_t				// O - Number of bytes snapped
+pcl_snap_avx2(
+    unsigned char       *dst,		// O - Destination
+    const unsigned char *src,		// I - Source
+    size_t              length,		// I - Number of bytes
+    unsigned char       tolerance)	// I - Tolerance
+{
+  size_t	i;			// Current byte
+  const __m256i	lo = _mm256_set1_epi8((char)tolerance),
+		hi = _mm256_set1_epi8((char)(255 - tolerance));
+					// Snapping limits
+
+
+  // 32 bytes at a time, then let SSE2 do the rest...
+  for (i = 0; (i + 32) <= length; i += 32)
+  {
+    __m256i	v = _mm256_loadu_si256((const __m256i *)(src + i)),
+		zero = _mm256_cmpeq_epi8(_mm256_min_epu8(v, lo), v),
+		one = _mm256_cmpeq_epi8(_mm256_max_epu8(v, hi), v);
+
+    _mm256_storeu_si256((__m256i *)(dst + i), _mm256_or_si256(_mm256_andnot_si256(zero, v), one));
+  }
+
+  return (i + pcl_snap_sse2(dst + i, src + i, length - i, tolerance));
+}
+#endif // PCL_X86
+
+
+//
+// 'pcl_snap_line()' - Snap nearly solid pixels to pure black or white.
+//
+// Anti-aliased text and off-white backgrounds otherwise dither to speckles
+// that break up the runs used by the compression modes.  Each 8-bit component
+// in the printable area within the tolerance of 0 or 255 is clamped to it.
+//
+
+static const unsigned char *		// O - Snapped line
+pcl_snap_line(
+    pcl_t               *pcl,		// I - Job data
+    const unsigned char *pixels)	// I - Line
+{
+  size_t	i,			// Current byte
+		start = pcl->xstart * pcl->bits_per_pixel / 8,
+					// First byte
+		end = pcl->xend * pcl->bits_per_pixel / 8;
+					// Last byte
+  unsigned char	*dst = pcl->snap_line;	// Snapped line
+  unsigned	lo = pcl->snap_tolerance,
+		hi = 255 - pcl->snap_tolerance;
+					// Snapping limits
+
 
-  // No blank lines yet...
-  pcl->feed = 0;
+  i = start + (pcl_kernels->snap ? (pcl_kernels->snap)(dst + start, pixels + start, end - start, (unsigned char)lo) : 0);
 
-  // Allocate memory for compression...
-  if ((pcl->comp_buffer = malloc(pcl->linesize * 2 + 2)) == NULL)
+  for (; i < end; i ++)
   {
-    papplLogJob(job, PAPPL_LOGLEVEL_ERROR, "Memory allocation failure.");
-    return (false);
+    if (pixels[i] <= lo)
+      dst[i] = 0;
+    else if (pixels[i] >= hi)
+      dst[i] = 255;
+    else
+      dst[i] = pixels[i];
   }
 
-  return (true);
+  return (dst);
 }
 
 
+#ifdef __ARM_NEON
 //
-// 'pcl_rwriteline()' - Write a line.
+// 'pcl_snap_neon()' - Snap nearly solid bytes to 0 or 255 using NEON.
 //
 
-static bool				// O - `true` on success, `false` on failure
-pcl_rwriteline(
-    pappl_job_t         *job,		// I - Job
-    pappl_pr_options_t  *options,	// I - Job options
-    pappl_device_t      *device,	// I - Device
-    unsigned            y,		// I - Line number
-    const unsigned char *pixels)	// I - Line
+static size_t				// O - Number of bytes snapped
+pcl_snap_neon(
+    unsigned char       *dst,		// O - Destination
+    const unsigned char *src,		// I - Source
+    size_t              length,		// I - Number of bytes
+    unsigned char       tolerance)	// I - Tolerance
 {
-  cups_page_header_t	*header = &(options->header);
-					// Page header
-  pcl_t			*pcl = (pcl_t *)papplJobGetData(job);
-					// Job data
-  unsigned		plane,		// Current plane
-			x;		// Current column
-  const unsigned char	*pixptr;	// Pixel pointer in line
-  unsigned char		bit,		// Current plane data
-			*cptr,		// Pointer into c-plane
-			*mptr,		// Pointer into m-plane
-			*yptr,		// Pointer into y-plane
-			*kptr,		// Pointer into k-plane
-			byte;		// Byte in line
-  const unsigned char	*dither;	// Dither line
-
-
-  // Skip top and bottom margin areas...
-  if (y < pcl->ystart || y >= pcl->yend)
-    return (true);
+  size_t	i;			// Current byte
+  const uint8x16_t lo = vdupq_n_u8(tolerance),
+		hi = vdupq_n_u8((uint8_t)(255 - tolerance));
+					// Snapping limits
 
-  if (!(y & 127))
-    papplLogJob(job, PAPPL_LOGLEVEL_DEBUG, "Printing line %u (%u%%)", y, 100 * (y - pcl->ystart) / pcl->height);
 
-  switch (pcl->driver)
+  // 16 bytes at a time...
+  for (i = 0; (i + 16) <= length; i += 16)
   {
-    case HP_DRIVER_DESKJET :
-    case HP_DRIVER_GENERIC :
-    case HP_DRIVER_LASERJET :
-	// Check whether the line is all whitespace...
-	byte = options->header.cupsColorSpace == CUPS_CSPACE_K ? 0 : 255;
+    uint8x16_t	v = vld1q_u8(src + i);
 
-	if (*pixels != byte || memcmp(pixels, pixels + 1, header->cupsBytesPerLine - 1))
-	{
-	  // No, skip previous whitespace as needed...
-	  if (pcl->feed > 0)
-	  {
-	    papplDevicePrintf(device, "\033*b%dY", pcl->feed);
-	    pcl->feed = 0;
-	  }
+    vst1q_u8(dst + i, vorrq_u8(vbicq_u8(v, vcleq_u8(v, lo)), vcgeq_u8(v, hi)));
+  }
 
-	  // Dither bitmap data...
-	  dither = options->dither[y & 15];
+  return (i);
+}
+#endif // __ARM_NEON
 
-	  if (pcl->num_planes > 1)
-	  {
-	    // RGB
-	    memset(pcl->planes[0], 0, pcl->num_planes * pcl->linesize);
 
-	    for (x = pcl->xstart, cptr = pcl->planes[1], mptr = pcl->planes[2], yptr = pcl->planes[3], kptr = pcl->planes[0], pixptr = pixels + 3 * pcl->xstart, bit = 128; x < pcl->xend; x ++)
-	    {
-	      if (*pixptr ++ < dither[x & 15])
-		*cptr |= bit;
-	      if (*pixptr ++ < dither[x & 15])
-		*mptr |= bit;
-	      if (*pixptr ++ < dither[x & 15])
-		*yptr |= bit;
-
-	      if (bit == 1)
-	      {
-		*kptr   = *cptr & *mptr & *yptr;
-		byte    = ~*kptr;
-		*cptr++ &= byte;
-		*mptr++ &= byte;
-		*yptr++ &= byte;
-		kptr ++;
-		bit = 128;
-	      }
-	      else
-		bit /= 2;
-	    }
-	  }
-	  else if (header->cupsBitsPerPixel == 8)
-	  {
-	    memset(pcl->planes[0], 0, pcl->linesize);
+#ifdef PCL_X86
+//
+// 'pcl_snap_sse2()' - Snap nearly solid bytes to 0 or 255 using SSE2.
+//
+// SSE2 has no unsigned byte comparisons, so "v <= lo" is tested as
+// "min(v, lo) == v" and "v >= hi" as "max(v, hi) == v".
+//
 
-	    if (header->cupsColorSpace == CUPS_CSPACE_K)
-	    {
-	      // 8 bit black
-	      for (x = pcl->xstart, kptr = pcl->planes[0], pixptr = pixels + pcl->xstart, bit = 128, byte = 0; x < pcl->xend; x ++, pixptr ++)
-	      {
-		if (*pixptr >= dither[x & 15])
-		  byte |= bit;
-
-		if (bit == 1)
-		{
-		  *kptr++ = byte;
-		  byte    = 0;
-		  bit     = 128;
-		}
-		else
-		  bit /= 2;
-	      }
-
-	      if (bit < 128)
-		*kptr = byte;
-	    }
-	    else
-	    {
-	      // 8 bit gray
-	      for (x = pcl->xstart, kptr = pcl->planes[0], pixptr = pixels + pcl->xstart, bit = 128, byte = 0; x < pcl->xend; x ++, pixptr ++)
-	      {
-		if (*pixptr < dither[x & 15])
-		  byte |= bit;
-
-		if (bit == 1)
-		{
-		  *kptr++ = byte;
-		  byte    = 0;
-		  bit     = 128;
-		}
-		else
-		  bit /= 2;
-	      }
-
-	      if (bit < 128)
-		*kptr = byte;
-	    }
-	  }
-	  else
-	  {
-	    // 1-bit B&W
-	    memcpy(pcl->planes[0], pixels + pcl->xstart / 8, pcl->linesize);
-	  }
+PCL_SSE2
+static size_t				// O - Number of bytes snapped
+pcl_snap_sse2(
+    unsigned char       *dst,		// O - Destination
+    const unsigned char *src,		// I - Source
+    size_t              length,		// I - Number of bytes
+    unsigned char       tolerance)	// I - Tolerance
+{
+  size_t	i;			// Current byte
+  const __m128i	lo = _mm_set1_epi8((char)tolerance),
+		hi = _mm_set1_epi8((char)(255 - tolerance));
+					// Snapping limits
 
-	  for (plane = 0; plane < pcl->num_planes; plane ++)
-	    pcl_compress_data(pcl, device, y, pcl->planes[plane], pcl->linesize, plane);
-	  papplDeviceFlush(device);
-	}
-	else
-	  pcl->feed ++;
-	break;
 
-#if WITH_PCL6
-    case HP_DRIVER_GENERIC6 :
-    case HP_DRIVER_GENERIC6C :
-	if (*pixels != byte || memcmp(pixels, pixels + 1, header->cupsBytesPerLine - 1))
-	  pcl_compress_data(pcl, device, y, pixels + pcl->xstart * header->cupsBitsPerPixel / 8, pcl->linesize, 0);
-	break;
-#endif // WITH_PCL6
+  // 16 bytes at a time...
+  for (i = 0; (i + 16) <= length; i += 16)
+  {
+    __m128i	v = _mm_loadu_si128((const __m128i *)(src + i)),
+		zero = _mm_cmpeq_epi8(_mm_min_epu8(v, lo), v),
+		one = _mm_cmpeq_epi8(_mm_max_epu8(v, hi), v);
+
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(_mm_andnot_si128(zero, v), one));
   }
 
-  return (true);
+  return (i);
 }
+#endif // PCL_X86
 
 
 //
@@ -1794,6 +5146,22 @@ pcl_status(
 }
 
 
+//
+// 'pcl_time()' - Get the current time in nanoseconds.
+//
+
+static uint64_t				// O - Monotonic time in nanoseconds
+pcl_time(void)
+{
+  struct timespec	ts;		// Current time
+
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ((uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec);
+}
+
+
 //
 // 'pcl_update_status()' - Update the supply levels and status.
 //
@@ -1816,7 +5184,304 @@ pcl_update_status(
 }
 
 
+//
+// 'pcl_worker_thread()' - Dither and compress bands from the raster ring.
+//
+
+static void *				// O - Thread exit status (not used)
+pcl_worker_thread(
+    pcl_worker_t *worker)		// I - Worker
+{
+  pcl_t		*pcl = worker->pcl;	// Job data
+  pcl_ring_t	*ring = &pcl->ring;	// Raster ring
+  pcl_band_t	*band;			// Current band
+  unsigned	next;			// Next band to encode
+
+
+  for (;;)
+  {
+    // Claim the next band, if any...
+    next = atomic_load(&ring->next);
+
+    if (next == atomic_load(&ring->head))
+    {
+      if (atomic_load(&ring->stop))
+        break;
+
+      // Nothing to do, wait for the job thread...
+      pthread_mutex_lock(&ring->mutex);
+      atomic_fetch_add(&ring->waiting, 1);
+
+      while (atomic_load(&ring->next) == atomic_load(&ring->head) && !atomic_load(&ring->stop))
+	pthread_cond_wait(&ring->cond, &ring->mutex);
+
+      atomic_fetch_sub(&ring->waiting, 1);
+      pthread_mutex_unlock(&ring->mutex);
+      continue;
+    }
+
+    if (!atomic_compare_exchange_weak(&ring->next, &next, next + 1))
+      continue;				// Another worker got it
+
+    band = ring->bands + (next & (ring->num_bands - 1));
+
+    if (!band->end)
+    {
+      uint64_t start = pcl_time();	// Start time
+
+      (pcl->encode_band)(pcl, worker, band);
+
+      worker->encode_nsecs += pcl_time() - start;
+      worker->encode_lines += band->num_lines;
+    }
+
+    // Pass the band to the output thread...
+    atomic_store(&band->done, true);
+    pcl_ring_notify(ring);
+  }
+
+  return (NULL);
+}
+
+
+//
+// 'pcl_write()' - Write data to the job output buffer.
+//
+// The buffer is only sent to the device when it fills up, so each raster line
+// no longer costs several device writes.
+//
+
+static void
+pcl_write(pcl_t          *pcl,		// I - Job data
+          pappl_device_t *device,	// I - Device
+          const void     *data,		// I - Data to write
+          size_t         length)	// I - Number of bytes
+{
+  if ((pcl->out_bytes + length) > sizeof(pcl->out_buffer))
+  {
+    pcl_write_flush(pcl, device);
+
+    if (length > sizeof(pcl->out_buffer))
+    {
+      // Too large to buffer, write it directly...
+      pcl_write_device(pcl, device, data, length);
+      return;
+    }
+  }
+
+  memcpy(pcl->out_buffer + pcl->out_bytes, data, length);
+  pcl->out_bytes += length;
+}
+
+
+//
+// 'pcl_write_device()' - Write data to the device, timing the write.
+//
+// The time spent blocked in the write is how the compression effort
+// controller measures the speed of the link to the printer.
+//
+
+static void
+pcl_write_device(
+    pcl_t          *pcl,		// I - Job data
+    pappl_device_t *device,		// I - Device
+    const void     *data,		// I - Data to write
+    size_t         length)		// I - Number of bytes
+{
+  uint64_t	start = pcl_time();	// Start time
+
+
+  if (papplDeviceWrite(device, data, length) < 0)
+    pcl->out_error = true;
+
+  pcl->io_nsecs += pcl_time() - start;
+  pcl->io_bytes += length;
+}
+
+
+//
+// 'pcl_write_flush()' - Send the job output buffer to the device.
+//
+
+static bool				// O - `true` on success, `false` on error
+pcl_write_flush(pcl_t          *pcl,	// I - Job data
+                pappl_device_t *device)	// I - Device
+{
+  if (pcl->out_bytes > 0)
+  {
+    pcl_write_device(pcl, device, pcl->out_buffer, pcl->out_bytes);
+
+    pcl->out_bytes = 0;
+  }
+
+  return (!pcl->out_error);
+}
+
+
+//
+// 'pcl_writeline_pcl5()' - Add a line to the current band for PCL 5 printers.
+//
+
+static bool				// O - `true` on success, `false` on error
+pcl_writeline_pcl5(
+    pcl_t               *pcl,		// I - Job data
+    pappl_device_t      *device,	// I - Device
+    unsigned            y,		// I - Line number
+    const unsigned char *pixels)	// I - Line
+{
+  pcl_band_t		*band;		// Band being filled
+  unsigned char		*line;		// Line in band
+
+
+  (void)device;
+
+  // Check whether the line is all whitespace...
+  if (pcl_blank_line(pcl, pixels))
+  {
+    pcl->feed ++;
+    return (true);
+  }
+
+  // No, stop if the output thread has had an error...
+  if (pcl->out_error)
+    return (false);
+
+  if ((band = pcl->band) == NULL)
+  {
+    // Start a new band, keeping a copy of the previous line for the seed
+    // rows...
+    band = pcl->band = pcl_ring_get(pcl);
+
+    if (pcl->prev_pixels && !pcl->feed)
+    {
+      band->has_prev = true;
+      band->prev_y   = pcl->prev_y;
+      memcpy(band->pixels, pcl->prev_pixels, pcl->bytes_per_line);
+    }
+  }
+
+  // Add the line to the band along with the number of blank lines to skip...
+  line = band->pixels + (band->num_lines + 1) * pcl->bytes_per_line;
+
+  memcpy(line, pixels, pcl->bytes_per_line);
+
+  band->y[band->num_lines]    = y;
+  band->feed[band->num_lines] = pcl->feed;
+  band->num_lines ++;
+
+  pcl->feed        = 0;
+  pcl->prev_pixels = line;
+  pcl->prev_y      = y;
+
+  // Send full bands to the workers...
+  if (band->num_lines == PCL_BAND_HEIGHT)
+  {
+    pcl_ring_put(pcl);
+    pcl->band = NULL;
+  }
+
+  return (true);
+}
+
+
 #if WITH_PCL6
+//
+// 'pcl_writeline_pcl6()' - Compress and send a line to PCL XL printers.
+//
+
+static bool				// O - `true` on success, `false` on error
+pcl_writeline_pcl6(
+    pcl_t               *pcl,		// I - Job data
+    pappl_device_t      *device,	// I - Device
+    unsigned            y,		// I - Line number
+    const unsigned char *pixels)	// I - Line
+{
+  const unsigned char	*line = pixels + pcl->xstart * pcl->bits_per_pixel / 8;
+					// Printable area of line
+  const unsigned char	*seed;		// Seed row for delta row compression
+  unsigned char		*rle,		// End of RLE-compressed data
+			*delta;		// Delta row-compressed line
+  unsigned		i,		// Looping var
+			count;		// Number of bytes
+
+
+  // Skip lines that are all whitespace, sending the lines before them...
+  if (pcl_blank_line(pcl, pixels))
+  {
+    pcl6_write_image(pcl, device);
+    return (true);
+  }
+
+  if (!pcl->image_lines)
+  {
+    pcl->image_y           = y;
+    pcl->image_rle_bytes   = 0;
+    pcl->image_delta_bytes = 0;
+  }
+
+  if (pcl->image_delta)
+  {
+    // Add the line delta row-compressed against the previous line sent...
+    if (pcl->image_lines)
+    {
+      seed = pcl->image_raw + (pcl->image_lines - 1) * pcl->linesize;
+    }
+    else if (pcl->image_seeded)
+    {
+      seed = pcl->image_seed;
+    }
+    else
+    {
+      // Printers differ on whether other compression modes update the seed
+      // row, so replace every byte of the first line after such a block...
+      for (i = 0; i < pcl->linesize; i ++)
+        pcl->workers->comp_buffer[i] = (unsigned char)~line[i];
+
+      seed = pcl->workers->comp_buffer;
+    }
+
+    delta    = pcl->image_delta + pcl->image_delta_bytes;
+    count    = pcl_compress_mode3(delta + 2, line, seed, (unsigned)pcl->linesize, (unsigned)(pcl->linesize + (pcl->linesize + 7) / 8 + 1));
+    delta[0] = (unsigned char)count;
+    delta[1] = (unsigned char)(count >> 8);
+
+    pcl->image_delta_bytes += 2 + count;
+  }
+
+  // Add the line to the block both uncompressed and RLE-compressed...
+  memcpy(pcl->image_raw + pcl->image_lines * pcl->linesize, line, pcl->linesize);
+
+  rle = pcl->image_rle + pcl->image_rle_bytes;
+
+  if ((count = pcl_compress_packbits(pcl->workers->comp_buffer, line, (unsigned)pcl->linesize)) <= pcl->linesize)
+  {
+    memcpy(rle, pcl->workers->comp_buffer, count);
+    rle += count;
+  }
+  else
+  {
+    // Larger than the line, so copy it as literal runs of up to 128 bytes...
+    for (i = 0; i < pcl->linesize; i += count)
+    {
+      if ((count = (unsigned)pcl->linesize - i) > 128)
+        count = 128;
+
+      *rle++ = (unsigned char)(count - 1);
+      memcpy(rle, line + i, count);
+      rle += count;
+    }
+  }
+
+  pcl->image_rle_bytes = (size_t)(rle - pcl->image_rle);
+
+  // Send full blocks...
+  if (++ pcl->image_lines == pcl->image_height)
+    pcl6_write_image(pcl, device);
+
+  return (true);
+}
+
+
 //
 // 'pcl6_write_command()' - Write a command without attributes.
 //
@@ -1871,6 +5536,63 @@ pcl6_write_data(
 }
 
 
+//
+// 'pcl6_write_image()' - Write a block of lines with a single ReadImage.
+//
+// Consecutive non-blank lines are collected in the job data by
+// `pcl_writeline_pcl6()` and sent with whichever of the delta row-compressed,
+// RLE-compressed, and uncompressed data is smaller.  Each line is
+// RLE-compressed separately so that runs never span lines, and the delta row
+// seed row carries over from the last line of the previous block.
+//
+
+static void
+pcl6_write_image(
+    pcl_t          *pcl,		// I - Job data
+    pappl_device_t *device)		// I - Output device
+{
+  size_t	raw_bytes = pcl->image_lines * pcl->linesize;
+					// Bytes of uncompressed data
+
+
+  if (!pcl->image_lines)
+    return;
+
+  pcl6_write_uint16(device, pcl->image_y - pcl->ystart, PCL6_ATTR_START_LINE);
+  pcl6_write_uint16(device, pcl->image_lines, PCL6_ATTR_BLOCK_HEIGHT);
+
+  if (pcl->image_delta && pcl->image_delta_bytes < raw_bytes && pcl->image_delta_bytes <= pcl->image_rle_bytes)
+  {
+    pcl6_write_ubyte(device, PCL6_E_DELTA_ROW_COMPRESSION, PCL6_ATTR_COMPRESS_MODE);
+    pcl6_write_command(device, PCL6_CMD_READ_IMAGE);
+    pcl6_write_data(device, pcl->image_delta, pcl->image_delta_bytes);
+
+    // The last line is now the printer's seed row...
+    memcpy(pcl->image_seed, pcl->image_raw + raw_bytes - pcl->linesize, pcl->linesize);
+    pcl->image_seeded = true;
+  }
+  else
+  {
+    if (pcl->image_rle_bytes < raw_bytes)
+    {
+      pcl6_write_ubyte(device, PCL6_E_RLE_COMPRESSION, PCL6_ATTR_COMPRESS_MODE);
+      pcl6_write_command(device, PCL6_CMD_READ_IMAGE);
+      pcl6_write_data(device, pcl->image_rle, pcl->image_rle_bytes);
+    }
+    else
+    {
+      pcl6_write_ubyte(device, PCL6_E_NO_COMPRESSION, PCL6_ATTR_COMPRESS_MODE);
+      pcl6_write_command(device, PCL6_CMD_READ_IMAGE);
+      pcl6_write_data(device, pcl->image_raw, raw_bytes);
+    }
+
+    pcl->image_seeded = false;
+  }
+
+  pcl->image_lines = 0;
+}
+
+
 #if 0
 //
 // 'pcl6_write_string()' - Write a single string attribute with optional command.